@@ -287,6 +287,19 @@ __read_mostly int scheduler_running;
  */
 int sysctl_sched_rt_runtime = 950000;
 
+/*
+ * SCHED_WRR timeslices of the foreground and background tiers in us,
+ * before scaling by the group's cpu.wrr_weight.
+ */
+unsigned int sysctl_sched_wrr_fore_timeslice_us = WRR_FORE_TIMESLICE_US;
+unsigned int sysctl_sched_wrr_back_timeslice_us = WRR_BACK_TIMESLICE_US;
+
+/*
+ * Slice left in us below which a running SCHED_WRR task is not preempted
+ * by a wakeup on an earlier level.
+ */
+unsigned int sysctl_sched_wrr_wakeup_granularity_us = WRR_WAKEUP_GRANULARITY_US;
+
 
 
 /*
@@ -1720,10 +1733,17 @@ static void __sched_fork(struct task_struct *p)
 
 #ifdef CONFIG_SCHEDSTATS
         memset(&p->se.statistics, 0, sizeof(p->se.statistics));
+        memset(&p->wrr.statistics, 0, sizeof(p->wrr.statistics));
 #endif
 
         INIT_LIST_HEAD(&p->rt.run_list);
         INIT_LIST_HEAD(&p->wrr.run_list);
+        p->wrr.fb_exec_start = 0;
+        p->wrr.fb_sleep = 0;
+        p->wrr.fb_sleep_start = 0;
+        p->wrr.avg_run = 0;
+        p->wrr.avg_sleep = 0;
+        p->wrr.boosted = 0;
 
 #ifdef CONFIG_PREEMPT_NOTIFIERS
         INIT_HLIST_HEAD(&p->preempt_notifiers);
@@ -1804,6 +1824,7 @@ void sched_fork(struct task_struct *p)
 #endif
 #ifdef CONFIG_SMP
         plist_node_init(&p->pushable_tasks, MAX_PRIO);
+        plist_node_init(&p->wrr.pushable_tasks, MAX_WRR_PRIO);
 #endif
 
         put_cpu();
@@ -3187,6 +3208,7 @@ void scheduler_tick(void)
 #ifdef CONFIG_SMP
         rq->idle_balance = idle_cpu(cpu);
         trigger_load_balance(rq, cpu);
+        trigger_wrr_load_balance(rq, cpu);
 #endif
 }
 
@@ -3371,6 +3393,8 @@ need_resched:
 
         pre_schedule(rq, prev);
 
+        if (unlikely(!rq->nr_running))
+                idle_pull_wrr_task(rq);
         if (unlikely(!rq->nr_running))
                 idle_balance(cpu, rq);
 
@@ -4180,8 +4204,12 @@ __setscheduler(struct rq *rq, struct task_struct *p, int policy, int prio)
 
         if (p->policy == SCHED_WRR){
                 p->sched_class = &wrr_sched_class;
+                /* Let the class place the task anew by its rt_priority */
+                p->wrr.prio = MAX_WRR_PRIO;
                 p->wrr.time_slice = p->sched_class->get_rr_interval(rq,p);
                 p->times = 1;
+                p->wrr.fb_exec_start = p->se.sum_exec_runtime;
+                p->wrr.fb_sleep = 0;
         }
         else if (rt_prio(p->prio))
                 p->sched_class = &rt_sched_class;
@@ -4209,8 +4237,9 @@ static bool check_same_owner(struct task_struct *p)
         return match;
 }
 
-static int __sched_setscheduler(struct task_struct *p, int policy,
-                                const struct sched_param *param, bool user)
+static int __sched_setscheduler_locked(struct task_struct *p, int policy,
+                                       const struct sched_param *param, bool user,
+                                       bool wrr_locked)
 {
         int retval, oldprio, oldpolicy = -1, on_rq, running;
         unsigned long flags;
@@ -4290,6 +4319,24 @@ recheck:
                         return retval;
         }
 
+#ifdef CONFIG_CGROUP_SCHED
+        /*
+         * The group's runqueues may not have queue heads for this level
+         * yet. The caller holds cgroup_mutex, so task_group(p) stays the
+         * group we allocate for until the task is queued at the new level.
+         * If @p only became SCHED_WRR after the caller checked, it does not
+         * hold it, and has to retry with it.
+         */
+        if (wrr_policy(policy)) {
+                if (!wrr_locked)
+                        return -EAGAIN;
+                retval = alloc_wrr_prio_chunks(task_group(p),
+                                               wrr_prio_level(param->sched_priority));
+                if (retval)
+                        return retval;
+        }
+#endif
+
         /*
          * make sure no PI-waiters arrive (or leave) while we are
          * changing the priority of the task:
@@ -4333,6 +4380,15 @@ recheck:
         }
 #endif
 
+#ifdef CONFIG_CGROUP_SCHED
+        /* Nor SCHED_WRR tasks into groups that have no WRR runtime */
+        if (user && wrr_policy(policy) &&
+                        task_group(p)->wrr_bandwidth.wrr_runtime == 0) {
+                task_rq_unlock(rq, p, &flags);
+                return -EPERM;
+        }
+#endif
+
         /* recheck policy now with rq lock held */
         if (unlikely(oldpolicy != -1 && oldpolicy != p->policy)) {
                 policy = oldpolicy = -1;
@@ -4367,6 +4423,40 @@ recheck:
         return 0;
 }
 
+static int __sched_setscheduler(struct task_struct *p, int policy,
+                                const struct sched_param *param, bool user)
+{
+        int retval;
+
+#ifdef CONFIG_CGROUP_SCHED
+        /*
+         * A cgroup move allocates WRR chunks for the task's level in
+         * cpu_cgroup_can_attach() and moves it in cpu_cgroup_attach(), all
+         * under cgroup_mutex. Taking it here keeps a move from landing
+         * between our allocation and the enqueue, and keeps the level from
+         * changing between the move's allocation and the move itself.
+         * Only SCHED_WRR tasks have a level, so changes that neither leave
+         * nor enter SCHED_WRR do not serialize on cgroup_mutex.
+         */
+        if (p->policy == SCHED_WRR ||
+            wrr_policy(policy < 0 ? p->policy : policy & ~SCHED_RESET_ON_FORK))
+                goto wrr_locked;
+
+        retval = __sched_setscheduler_locked(p, policy, param, user, false);
+        if (retval != -EAGAIN)
+                return retval;
+
+wrr_locked:
+        cgroup_lock();
+        retval = __sched_setscheduler_locked(p, policy, param, user, true);
+        cgroup_unlock();
+
+        return retval;
+#else
+        return __sched_setscheduler_locked(p, policy, param, user, false);
+#endif
+}
+
 /**
  * sched_setscheduler - change the scheduling policy and/or RT priority of a thread.
  * @p: the task in question.
@@ -4411,13 +4501,19 @@ do_sched_setscheduler(pid_t pid, int policy, struct sched_param __user *param)
         if (copy_from_user(&lparam, param, sizeof(struct sched_param)))
                 return -EFAULT;
 
+        /* Setting SCHED_WRR may sleep, so pin the task instead of holding RCU */
         rcu_read_lock();
         retval = -ESRCH;
         p = find_process_by_pid(pid);
         if (p != NULL)
-                retval = sched_setscheduler(p, policy, &lparam);
+                get_task_struct(p);
         rcu_read_unlock();
 
+        if (p != NULL) {
+                retval = sched_setscheduler(p, policy, &lparam);
+                put_task_struct(p);
+        }
+
         return retval;
 }
 
@@ -5837,7 +5933,9 @@ static void free_rootdomain(struct rcu_head *rcu)
 {
         struct root_domain *rd = container_of(rcu, struct root_domain, rcu);
 
+        wrrpri_cleanup(&rd->wrrpri);
         cpupri_cleanup(&rd->cpupri);
+        free_cpumask_var(rd->wrro_mask);
         free_cpumask_var(rd->rto_mask);
         free_cpumask_var(rd->online);
         free_cpumask_var(rd->span);
@@ -5891,11 +5989,19 @@ static int init_rootdomain(struct root_domain *rd)
                 goto free_span;
         if (!alloc_cpumask_var(&rd->rto_mask, GFP_KERNEL))
                 goto free_online;
+        if (!alloc_cpumask_var(&rd->wrro_mask, GFP_KERNEL))
+                goto free_rto_mask;
 
         if (cpupri_init(&rd->cpupri) != 0)
-                goto free_rto_mask;
+                goto free_wrro_mask;
+        if (wrrpri_init(&rd->wrrpri) != 0)
+                goto free_cpupri;
         return 0;
 
+free_cpupri:
+        cpupri_cleanup(&rd->cpupri);
+free_wrro_mask:
+        free_cpumask_var(rd->wrro_mask);
 free_rto_mask:
         free_cpumask_var(rd->rto_mask);
 free_online:
@@ -7082,21 +7188,464 @@ LIST_HEAD(task_groups);
 
 DECLARE_PER_CPU(cpumask_var_t, load_balance_tmpmask);
 
+/* Queue heads of the root wrr_rq of every cpu, which may see any level */
+static DEFINE_PER_CPU(struct wrr_prio_chunk, root_wrr_prio_chunks[WRR_PRIO_CHUNKS]);
+
+static void init_wrr_prio_chunk(struct wrr_prio_chunk *chunk)
+{
+    int i;
+
+    for (i = 0; i < WRR_PRIO_CHUNK_SIZE; i++)
+        INIT_LIST_HEAD(chunk->queue + i);
+}
+
+/* Group runqueues start without chunks, see alloc_wrr_prio_chunks() */
 void init_wrr_rq(struct wrr_rq *wrr_rq, struct rq *rq)
 {
     printk("init wrr runqueue!");
     struct wrr_prio_array *array;
     int i;
 
+    /*
+     * Keep the WRR fast path fields within one cache line, see sched.h.
+     * The counters and the bitmap take 36 bytes on 32-bit, so cpus with
+     * 32-byte lines (ARMv5/v6) get them in two; hold them to 64 bytes.
+     */
+    BUILD_BUG_ON(offsetof(struct wrr_rq, active.chunk) >
+                 (L1_CACHE_BYTES > 64 ? L1_CACHE_BYTES : 64));
+    BUILD_BUG_ON(sizeof(struct wrr_prio_array) > 2 * L1_CACHE_BYTES);
+    BUILD_BUG_ON(offsetof(struct sched_wrr_entity, weight) +
+                 sizeof(unsigned int) > L1_CACHE_BYTES);
+
     array = &wrr_rq->active;
-    for (i = 0; i < MAX_WRR_PRIO; i++)
+    bitmap_zero(array->bitmap, MAX_WRR_PRIO);
+    __set_bit(MAX_WRR_PRIO, array->bitmap);
+
+    for (i = 0; i < WRR_PRIO_CHUNKS; i++)
+        array->chunk[i] = NULL;
+
+    wrr_rq->rq = rq;
+    wrr_rq->highest_prio.curr = MAX_WRR_PRIO;
+#ifdef CONFIG_SMP
+    wrr_rq->highest_prio.next = MAX_WRR_PRIO;
+    wrr_rq->wrr_nr_migratory = 0;
+    wrr_rq->wrr_nr_total = 0;
+    wrr_rq->overloaded = 0;
+    plist_head_init(&wrr_rq->pushable_tasks);
+#endif
+
+    wrr_rq->wrr_time = 0;
+    wrr_rq->wrr_throttled = 0;
+    wrr_rq->wrr_runtime = 0;
+    raw_spin_lock_init(&wrr_rq->wrr_runtime_lock);
+}
+
+/* Hand the root wrr_rq of @cpu its full set of queue heads */
+static void init_root_wrr_prio_chunks(struct wrr_rq *wrr_rq, int cpu)
+{
+    int i;
+
+    for (i = 0; i < WRR_PRIO_CHUNKS; i++)
     {
-        INIT_LIST_HEAD(array->queue + i);
-        __clear_bit(i, array->bitmap);
+        wrr_rq->active.chunk[i] = &per_cpu(root_wrr_prio_chunks, cpu)[i];
+        init_wrr_prio_chunk(wrr_rq->active.chunk[i]);
     }
-    __set_bit(MAX_WRR_PRIO, array->bitmap);
+}
+
+/*
+ * WRR bandwidth control, modelled on the rt_bandwidth code in rt.c. Each
+ * wrr_rq of a group with a finite wrr_runtime is charged the time its
+ * tasks run, can borrow unused runtime from the group's wrr_rqs on other
+ * cpus, and is throttled through the class' sched_wrr_rq_dequeue() when
+ * it runs out. The group's period timer pays the runtime back and hands
+ * throttled runqueues to sched_wrr_rq_enqueue().
+ */
+static int do_sched_wrr_period_timer(struct wrr_bandwidth *wrr_b, int overrun);
+
+static enum hrtimer_restart sched_wrr_period_timer(struct hrtimer *timer)
+{
+        struct wrr_bandwidth *wrr_b =
+                container_of(timer, struct wrr_bandwidth, wrr_period_timer);
+        ktime_t now;
+        int overrun;
+        int idle = 0;
+
+        for (;;) {
+                now = hrtimer_cb_get_time(timer);
+                overrun = hrtimer_forward(timer, now, wrr_b->wrr_period);
+
+                if (!overrun)
+                        break;
+
+                idle = do_sched_wrr_period_timer(wrr_b, overrun);
+        }
+
+        return idle ? HRTIMER_NORESTART : HRTIMER_RESTART;
+}
+
+void init_wrr_bandwidth(struct wrr_bandwidth *wrr_b, u64 period, u64 runtime)
+{
+        wrr_b->wrr_period = ns_to_ktime(period);
+        wrr_b->wrr_runtime = runtime;
+
+        raw_spin_lock_init(&wrr_b->wrr_runtime_lock);
 
-    //wrr_rq->wrr_time = 0;
+        hrtimer_init(&wrr_b->wrr_period_timer,
+                     CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+        wrr_b->wrr_period_timer.function = sched_wrr_period_timer;
+}
+
+void destroy_wrr_bandwidth(struct wrr_bandwidth *wrr_b)
+{
+        hrtimer_cancel(&wrr_b->wrr_period_timer);
+}
+
+static void start_wrr_bandwidth(struct wrr_bandwidth *wrr_b)
+{
+        if (wrr_b->wrr_runtime == RUNTIME_INF)
+                return;
+
+        if (hrtimer_active(&wrr_b->wrr_period_timer))
+                return;
+
+        raw_spin_lock(&wrr_b->wrr_runtime_lock);
+        start_bandwidth_timer(&wrr_b->wrr_period_timer, wrr_b->wrr_period);
+        raw_spin_unlock(&wrr_b->wrr_runtime_lock);
+}
+
+static inline struct wrr_bandwidth *sched_wrr_bandwidth(struct wrr_rq *wrr_rq)
+{
+        return &wrr_rq->tg->wrr_bandwidth;
+}
+
+static inline const struct cpumask *sched_wrr_period_mask(void)
+{
+#ifdef CONFIG_SMP
+        return cpu_rq(smp_processor_id())->rd->span;
+#else
+        return cpu_online_mask;
+#endif
+}
+
+#ifdef CONFIG_SMP
+/*
+ * We ran out of runtime, see if we can borrow some from the wrr_rqs of
+ * the same group on the other cpus of our root domain.
+ */
+static int do_balance_wrr_runtime(struct wrr_rq *wrr_rq)
+{
+        struct task_group *tg = wrr_rq->tg;
+        struct wrr_bandwidth *wrr_b = sched_wrr_bandwidth(wrr_rq);
+        struct root_domain *rd = wrr_rq->rq->rd;
+        int i, weight, more = 0;
+        u64 wrr_period;
+
+        weight = cpumask_weight(rd->span);
+
+        raw_spin_lock(&wrr_b->wrr_runtime_lock);
+        wrr_period = ktime_to_ns(wrr_b->wrr_period);
+        for_each_cpu(i, rd->span) {
+                struct wrr_rq *iter = tg->wrr_rq[i];
+                s64 diff;
+
+                if (iter == wrr_rq)
+                        continue;
+
+                raw_spin_lock(&iter->wrr_runtime_lock);
+                /*
+                 * disable_wrr_runtime() sets an offline cpu's runtime to inf,
+                 * which is not to be lent out.
+                 */
+                if (iter->wrr_runtime == RUNTIME_INF)
+                        goto next;
+
+                /*
+                 * From runqueues with spare time, take 1/n part of their
+                 * spare time, but no more than our period.
+                 */
+                diff = iter->wrr_runtime - iter->wrr_time;
+                if (diff > 0) {
+                        diff = div_u64((u64)diff, weight);
+                        if (wrr_rq->wrr_runtime + diff > wrr_period)
+                                diff = wrr_period - wrr_rq->wrr_runtime;
+                        iter->wrr_runtime -= diff;
+                        wrr_rq->wrr_runtime += diff;
+                        more = 1;
+                        if (wrr_rq->wrr_runtime == wrr_period) {
+                                raw_spin_unlock(&iter->wrr_runtime_lock);
+                                break;
+                        }
+                }
+next:
+                raw_spin_unlock(&iter->wrr_runtime_lock);
+        }
+        raw_spin_unlock(&wrr_b->wrr_runtime_lock);
+
+        return more;
+}
+
+static int balance_wrr_runtime(struct wrr_rq *wrr_rq)
+{
+        int more = 0;
+
+        if (wrr_rq->wrr_time > wrr_rq->wrr_runtime) {
+                raw_spin_unlock(&wrr_rq->wrr_runtime_lock);
+                more = do_balance_wrr_runtime(wrr_rq);
+                raw_spin_lock(&wrr_rq->wrr_runtime_lock);
+        }
+
+        return more;
+}
+
+/*
+ * Ensure the wrr_rqs of @rq take back all the runtime they lent to their
+ * neighbours before @rq leaves its root domain. Called with rq->lock held.
+ */
+void disable_wrr_runtime(struct rq *rq)
+{
+        struct root_domain *rd = rq->rd;
+        struct task_group *tg;
+        struct wrr_rq *wrr_rq;
+
+        if (unlikely(!scheduler_running))
+                return;
+
+        rcu_read_lock();
+        list_for_each_entry_rcu(tg, &task_groups, list) {
+                struct wrr_bandwidth *wrr_b = &tg->wrr_bandwidth;
+                s64 want;
+                int i;
+
+                /* Groups of the basic and RMLFQ variants have no wrr_rqs */
+                if (!tg->wrr_rq)
+                        continue;
+
+                wrr_rq = tg->wrr_rq[cpu_of(rq)];
+                if (!wrr_rq)
+                        continue;
+
+                raw_spin_lock(&wrr_b->wrr_runtime_lock);
+                raw_spin_lock(&wrr_rq->wrr_runtime_lock);
+                /*
+                 * Either we're all inf and nobody needs to borrow, or we're
+                 * already disabled and thus have nothing to do, or we have
+                 * exactly the right amount of runtime to take out.
+                 */
+                if (wrr_rq->wrr_runtime == RUNTIME_INF ||
+                    wrr_rq->wrr_runtime == wrr_b->wrr_runtime)
+                        goto balanced;
+                raw_spin_unlock(&wrr_rq->wrr_runtime_lock);
+
+                /*
+                 * Calculate the difference between what we started out with
+                 * and what we current have, that's the amount of runtime
+                 * we lend and now have to reclaim.
+                 */
+                want = wrr_b->wrr_runtime - wrr_rq->wrr_runtime;
+
+                /*
+                 * Greedy reclaim, take back as much as we can.
+                 */
+                for_each_cpu(i, rd->span) {
+                        struct wrr_rq *iter = tg->wrr_rq[i];
+                        s64 diff;
+
+                        /*
+                         * Can't reclaim from ourselves or disabled runqueues.
+                         */
+                        if (iter == wrr_rq || iter->wrr_runtime == RUNTIME_INF)
+                                continue;
+
+                        raw_spin_lock(&iter->wrr_runtime_lock);
+                        if (want > 0) {
+                                diff = min_t(s64, iter->wrr_runtime, want);
+                                iter->wrr_runtime -= diff;
+                                want -= diff;
+                        } else {
+                                iter->wrr_runtime -= want;
+                                want -= want;
+                        }
+                        raw_spin_unlock(&iter->wrr_runtime_lock);
+
+                        if (!want)
+                                break;
+                }
+
+                raw_spin_lock(&wrr_rq->wrr_runtime_lock);
+                /*
+                 * We cannot be left wanting - that would mean some runtime
+                 * leaked out of the system.
+                 */
+                BUG_ON(want);
+balanced:
+                /*
+                 * Disable all the borrow logic by pretending we have inf
+                 * runtime - in which case borrowing doesn't make sense.
+                 */
+                wrr_rq->wrr_runtime = RUNTIME_INF;
+                if (wrr_rq->wrr_throttled) {
+                        wrr_rq->wrr_throttled = 0;
+                        sched_wrr_rq_enqueue(wrr_rq);
+                }
+                raw_spin_unlock(&wrr_rq->wrr_runtime_lock);
+                raw_spin_unlock(&wrr_b->wrr_runtime_lock);
+        }
+        rcu_read_unlock();
+}
+
+/* Reset the runtime of the wrr_rqs of @rq when it comes online */
+void enable_wrr_runtime(struct rq *rq)
+{
+        struct task_group *tg;
+        struct wrr_rq *wrr_rq;
+
+        if (unlikely(!scheduler_running))
+                return;
+
+        rcu_read_lock();
+        list_for_each_entry_rcu(tg, &task_groups, list) {
+                struct wrr_bandwidth *wrr_b = &tg->wrr_bandwidth;
+
+                if (!tg->wrr_rq)
+                        continue;
+
+                wrr_rq = tg->wrr_rq[cpu_of(rq)];
+                if (!wrr_rq)
+                        continue;
+
+                raw_spin_lock(&wrr_b->wrr_runtime_lock);
+                raw_spin_lock(&wrr_rq->wrr_runtime_lock);
+                wrr_rq->wrr_runtime = wrr_b->wrr_runtime;
+                wrr_rq->wrr_time = 0;
+                wrr_rq->wrr_throttled = 0;
+                raw_spin_unlock(&wrr_rq->wrr_runtime_lock);
+                raw_spin_unlock(&wrr_b->wrr_runtime_lock);
+        }
+        rcu_read_unlock();
+}
+#else /* !CONFIG_SMP */
+static inline int balance_wrr_runtime(struct wrr_rq *wrr_rq)
+{
+        return 0;
+}
+
+void disable_wrr_runtime(struct rq *rq) {}
+void enable_wrr_runtime(struct rq *rq) {}
+#endif /* CONFIG_SMP */
+
+static int do_sched_wrr_period_timer(struct wrr_bandwidth *wrr_b, int overrun)
+{
+        struct task_group *tg = container_of(wrr_b, struct task_group, wrr_bandwidth);
+        int i, idle = 1, throttled = 0;
+        const struct cpumask *span;
+
+        /*
+         * Only armed from a queued wrr_rq of @tg, but a group without
+         * wrr_rqs has nothing to refill; let the timer stop.
+         */
+        if (!tg->wrr_rq)
+                return 1;
+
+        span = sched_wrr_period_mask();
+        for_each_cpu(i, span) {
+                int enqueue = 0;
+                struct wrr_rq *wrr_rq = tg->wrr_rq[i];
+                struct rq *rq = wrr_rq->rq;
+
+                raw_spin_lock(&rq->lock);
+                if (wrr_rq->wrr_time) {
+                        u64 runtime;
+
+                        raw_spin_lock(&wrr_rq->wrr_runtime_lock);
+                        if (wrr_rq->wrr_throttled)
+                                balance_wrr_runtime(wrr_rq);
+                        runtime = wrr_rq->wrr_runtime;
+                        wrr_rq->wrr_time -= min(wrr_rq->wrr_time, overrun * runtime);
+                        if (wrr_rq->wrr_throttled && wrr_rq->wrr_time < runtime) {
+                                wrr_rq->wrr_throttled = 0;
+                                enqueue = 1;
+
+                                /*
+                                 * Force a clock update if the CPU was idle,
+                                 * lest wakeup -> unthrottle time accumulate.
+                                 */
+                                if (wrr_rq->wrr_nr_running && rq->curr == rq->idle)
+                                        rq->skip_clock_update = -1;
+                        }
+                        if (wrr_rq->wrr_time || wrr_rq->wrr_nr_running)
+                                idle = 0;
+                        raw_spin_unlock(&wrr_rq->wrr_runtime_lock);
+                } else if (wrr_rq->wrr_nr_running)
+                        idle = 0;
+
+                if (wrr_rq->wrr_throttled)
+                        throttled = 1;
+
+                if (enqueue)
+                        sched_wrr_rq_enqueue(wrr_rq);
+                raw_spin_unlock(&rq->lock);
+        }
+
+        if (!throttled && wrr_b->wrr_runtime == RUNTIME_INF)
+                return 1;
+
+        return idle;
+}
+
+/* Called with wrr_rq->wrr_runtime_lock held */
+static int sched_wrr_runtime_exceeded(struct wrr_rq *wrr_rq)
+{
+        struct wrr_bandwidth *wrr_b = sched_wrr_bandwidth(wrr_rq);
+        u64 runtime = wrr_rq->wrr_runtime;
+
+        if (wrr_rq->wrr_throttled)
+                return 1;
+
+        if (runtime >= ktime_to_ns(wrr_b->wrr_period))
+                return 0;
+
+        balance_wrr_runtime(wrr_rq);
+        runtime = wrr_rq->wrr_runtime;
+        if (runtime == RUNTIME_INF)
+                return 0;
+
+        if (wrr_rq->wrr_time > runtime) {
+                static bool once = false;
+
+                wrr_rq->wrr_throttled = 1;
+
+                if (!once) {
+                        once = true;
+                        printk_sched("sched: WRR throttling activated\n");
+                }
+
+                sched_wrr_rq_dequeue(wrr_rq);
+                return 1;
+        }
+
+        return 0;
+}
+
+/*
+ * Charge @delta_exec of WRR execution to @wrr_rq. Returns 1 if @wrr_rq is
+ * throttled and its running task has to make way. Called with rq->lock
+ * held from the class' update_curr_wrr().
+ */
+int sched_wrr_charge_runtime(struct wrr_rq *wrr_rq, u64 delta_exec)
+{
+        int exceeded;
+
+        if (wrr_rq->wrr_runtime == RUNTIME_INF)
+                return 0;
+
+        start_wrr_bandwidth(sched_wrr_bandwidth(wrr_rq));
+
+        raw_spin_lock(&wrr_rq->wrr_runtime_lock);
+        wrr_rq->wrr_time += delta_exec;
+        exceeded = sched_wrr_runtime_exceeded(wrr_rq);
+        raw_spin_unlock(&wrr_rq->wrr_runtime_lock);
+
+        return exceeded;
 }
 
 /*
@@ -7118,6 +7667,7 @@ void init_tg_wrr_entry(struct task_group *tg, struct wrr_rq *wrr_rq,
         //wrr_rq->wrr_nr_boosted = 0;
         wrr_rq->rq = rq;
         wrr_rq->tg = tg;
+        wrr_rq->wrr_runtime = tg->wrr_bandwidth.wrr_runtime;
 
         tg->wrr_rq[cpu] = wrr_rq;
         tg->wrr_se[cpu] = wrr_se;
@@ -7135,6 +7685,67 @@ void init_tg_wrr_entry(struct task_group *tg, struct wrr_rq *wrr_rq,
         INIT_LIST_HEAD(&wrr_se->run_list);
 }
 
+#ifdef CONFIG_CGROUP_SCHED
+/*
+ * Make sure the runqueues of @tg and its ancestors on every cpu can queue
+ * an entity at WRR level @prio. Called from process context before a task
+ * of that level joins @tg; the chunks then stay until the group is freed.
+ * Group runqueues queue tasks at wrr_prio_level() of their rt_priority.
+ */
+int alloc_wrr_prio_chunks(struct task_group *tg, int prio)
+{
+        struct wrr_prio_chunk *chunk;
+        struct wrr_prio_array *array;
+        int c = prio / WRR_PRIO_CHUNK_SIZE;
+        int i;
+
+        for (; tg; tg = tg->parent) {
+                /* the variant has no group runqueues */
+                if (!tg->wrr_rq)
+                        continue;
+
+                for_each_possible_cpu(i) {
+                        if (!tg->wrr_rq[i] || tg->wrr_rq[i]->active.chunk[c])
+                                continue;
+
+                        chunk = kzalloc_node(sizeof(*chunk), GFP_KERNEL,
+                                             cpu_to_node(i));
+                        if (!chunk)
+                                return -ENOMEM;
+                        init_wrr_prio_chunk(chunk);
+
+                        array = &tg->wrr_rq[i]->active;
+                        raw_spin_lock_irq(&cpu_rq(i)->lock);
+                        if (!array->chunk[c]) {
+                                array->chunk[c] = chunk;
+                                chunk = NULL;
+                        }
+                        raw_spin_unlock_irq(&cpu_rq(i)->lock);
+                        kfree(chunk);
+                }
+        }
+
+        return 0;
+}
+
+/* Free the chunks of a group runqueue */
+void free_wrr_prio_chunks(struct wrr_prio_array *array)
+{
+        int i;
+
+        for (i = 0; i < WRR_PRIO_CHUNKS; i++) {
+                kfree(array->chunk[i]);
+                array->chunk[i] = NULL;
+        }
+}
+
+/* Recompute the cached slice after the group's class or weight changed */
+static void tg_update_wrr_timeslice(struct task_group *tg)
+{
+        tg->wrr_timeslice = sched_wrr_timeslice(tg->wrr_class, tg->wrr_weight);
+}
+#endif
+
 void __init sched_init(void)
 {
         int i, j;
@@ -7199,7 +7810,11 @@ void __init sched_init(void)
 #endif /* CONFIG_RT_GROUP_SCHED */
 
 #ifdef CONFIG_CGROUP_SCHED
+        init_wrr_bandwidth(&root_task_group.wrr_bandwidth,
+                        (u64)WRR_DEFAULT_PERIOD_US * NSEC_PER_USEC, RUNTIME_INF);
         list_add(&root_task_group.list, &task_groups);
+        root_task_group.wrr_weight = WRR_DEFAULT_WEIGHT;
+        tg_update_wrr_timeslice(&root_task_group);
         INIT_LIST_HEAD(&root_task_group.children);
         INIT_LIST_HEAD(&root_task_group.siblings);
         autogroup_init(&init_task);
@@ -7223,6 +7838,7 @@ void __init sched_init(void)
                 init_cfs_rq(&rq->cfs);
                 init_rt_rq(&rq->rt, rq);
                 init_wrr_rq(&rq->wrr, rq);
+                init_root_wrr_prio_chunks(&rq->wrr, i);
 #ifdef CONFIG_FAIR_GROUP_SCHED
                 root_task_group.shares = ROOT_TASK_GROUP_LOAD;
                 INIT_LIST_HEAD(&rq->leaf_cfs_rq_list);
@@ -7326,6 +7942,7 @@ void __init sched_init(void)
                 zalloc_cpumask_var(&cpu_isolated_map, GFP_NOWAIT);
 #endif
         init_sched_fair_class();
+        init_sched_wrr_class();
 
         scheduler_running = 1;
 }
@@ -7496,6 +8113,7 @@ static void free_sched_group(struct task_group *tg)
 {
         free_fair_sched_group(tg);
         free_rt_sched_group(tg);
+        destroy_wrr_bandwidth(&tg->wrr_bandwidth);
         free_wrr_sched_group(tg);
         autogroup_free(tg);
         kfree(tg);
@@ -7511,6 +8129,9 @@ struct task_group *sched_create_group(struct task_group *parent)
         if (!tg)
                 return ERR_PTR(-ENOMEM);
 
+        init_wrr_bandwidth(&tg->wrr_bandwidth,
+                        ktime_to_ns(parent->wrr_bandwidth.wrr_period), RUNTIME_INF);
+
         if (!alloc_fair_sched_group(tg, parent))
                 goto err;
 
@@ -7520,6 +8141,9 @@ struct task_group *sched_create_group(struct task_group *parent)
         if (!alloc_wrr_sched_group(tg, parent))
                 goto err;
 
+        tg->wrr_weight = WRR_DEFAULT_WEIGHT;
+        tg_update_wrr_timeslice(tg);
+
         spin_lock_irqsave(&task_group_lock, flags);
         list_add_rcu(&tg->list, &task_groups);
 
@@ -7605,6 +8229,137 @@ void sched_move_task(struct task_struct *tsk)
 
         task_rq_unlock(rq, tsk, &flags);
 }
+
+/*
+ * Set the cpu.wrr_weight of a group. Queued tasks pick up the new slice
+ * when their current one expires.
+ */
+int sched_group_set_wrr_weight(struct task_group *tg, unsigned long weight)
+{
+        /* The root group's tasks always get the unscaled tier slice */
+        if (tg == &root_task_group)
+                return -EINVAL;
+
+        tg->wrr_weight = clamp(weight, (unsigned long)WRR_MIN_WEIGHT,
+                               (unsigned long)WRR_MAX_WEIGHT);
+        tg_update_wrr_timeslice(tg);
+
+        return 0;
+}
+
+static DEFINE_MUTEX(wrr_constraints_mutex);
+
+/* Must be called with tasklist_lock held */
+static inline int tg_has_wrr_tasks(struct task_group *tg)
+{
+        struct task_struct *g, *p;
+
+        do_each_thread(g, p) {
+                if (p->policy == SCHED_WRR && task_group(p) == tg)
+                        return 1;
+        } while_each_thread(g, p);
+
+        return 0;
+}
+
+/*
+ * Groups below the root only have wrr_rqs when the class does group
+ * scheduling; without them there is nothing to charge. A group's time is
+ * also charged to every ancestor, so unlike the RT groups the children's
+ * runtimes need not add up to less than their parent's.
+ */
+static int tg_set_wrr_bandwidth(struct task_group *tg,
+                u64 wrr_period, u64 wrr_runtime)
+{
+        int i, err = 0;
+
+        if (!tg->wrr_rq)
+                return -EINVAL;
+
+        if (wrr_runtime > wrr_period && wrr_runtime != RUNTIME_INF)
+                return -EINVAL;
+
+        mutex_lock(&wrr_constraints_mutex);
+        read_lock(&tasklist_lock);
+        /* Don't starve existing WRR tasks */
+        if (!wrr_runtime && tg_has_wrr_tasks(tg)) {
+                err = -EBUSY;
+                goto unlock;
+        }
+
+        raw_spin_lock_irq(&tg->wrr_bandwidth.wrr_runtime_lock);
+        tg->wrr_bandwidth.wrr_period = ns_to_ktime(wrr_period);
+        tg->wrr_bandwidth.wrr_runtime = wrr_runtime;
+
+        for_each_possible_cpu(i) {
+                struct wrr_rq *wrr_rq = tg->wrr_rq[i];
+
+                raw_spin_lock(&wrr_rq->wrr_runtime_lock);
+                wrr_rq->wrr_runtime = wrr_runtime;
+                raw_spin_unlock(&wrr_rq->wrr_runtime_lock);
+        }
+        raw_spin_unlock_irq(&tg->wrr_bandwidth.wrr_runtime_lock);
+unlock:
+        read_unlock(&tasklist_lock);
+        mutex_unlock(&wrr_constraints_mutex);
+
+        return err;
+}
+
+int sched_group_set_wrr_runtime(struct task_group *tg, long wrr_runtime_us)
+{
+        u64 wrr_runtime, wrr_period;
+
+        wrr_period = ktime_to_ns(tg->wrr_bandwidth.wrr_period);
+        wrr_runtime = (u64)wrr_runtime_us * NSEC_PER_USEC;
+        if (wrr_runtime_us < 0)
+                wrr_runtime = RUNTIME_INF;
+
+        return tg_set_wrr_bandwidth(tg, wrr_period, wrr_runtime);
+}
+
+long sched_group_wrr_runtime(struct task_group *tg)
+{
+        u64 wrr_runtime_us;
+
+        if (tg->wrr_bandwidth.wrr_runtime == RUNTIME_INF)
+                return -1;
+
+        wrr_runtime_us = tg->wrr_bandwidth.wrr_runtime;
+        do_div(wrr_runtime_us, NSEC_PER_USEC);
+        return wrr_runtime_us;
+}
+
+int sched_group_set_wrr_period(struct task_group *tg, long wrr_period_us)
+{
+        u64 wrr_runtime, wrr_period;
+
+        wrr_period = (u64)wrr_period_us * NSEC_PER_USEC;
+        wrr_runtime = tg->wrr_bandwidth.wrr_runtime;
+
+        if (wrr_period == 0)
+                return -EINVAL;
+
+        return tg_set_wrr_bandwidth(tg, wrr_period, wrr_runtime);
+}
+
+long sched_group_wrr_period(struct task_group *tg)
+{
+        u64 wrr_period_us;
+
+        wrr_period_us = ktime_to_ns(tg->wrr_bandwidth.wrr_period);
+        do_div(wrr_period_us, NSEC_PER_USEC);
+        return wrr_period_us;
+}
+
+static int sched_wrr_can_attach(struct task_group *tg, struct task_struct *tsk)
+{
+        /* Don't accept WRR tasks when there is no way for them to run */
+        if (tsk->policy == SCHED_WRR && tg->wrr_bandwidth.wrr_runtime == 0)
+                return 0;
+
+        return 1;
+}
 #endif /* CONFIG_CGROUP_SCHED */
 
 #if defined(CONFIG_RT_GROUP_SCHED) || defined(CONFIG_CFS_BANDWIDTH)
@@ -7886,6 +8641,104 @@ int sched_rt_handler(struct ctl_table *table, int write,
         return ret;
 }
 
+/*
+ * Slice in jiffies of a SCHED_WRR task in a group of class @wrr_class and
+ * weight @weight. Root and autogroup tasks get the foreground slice.
+ */
+unsigned int sched_wrr_timeslice(int wrr_class, unsigned int weight)
+{
+        u64 slice_us;
+
+        if (wrr_class == WRR_GROUP_BACK)
+                slice_us = sysctl_sched_wrr_back_timeslice_us;
+        else
+                slice_us = sysctl_sched_wrr_fore_timeslice_us;
+
+        slice_us = div_u64(slice_us * weight, WRR_DEFAULT_WEIGHT);
+
+        return max_t(unsigned long, usecs_to_jiffies(slice_us), 1);
+}
+
+int sched_wrr_timeslice_handler(struct ctl_table *table, int write,
+                void __user *buffer, size_t *lenp,
+                loff_t *ppos)
+{
+        int ret;
+        static DEFINE_MUTEX(mutex);
+
+        mutex_lock(&mutex);
+        ret = proc_dointvec_minmax(table, write, buffer, lenp, ppos);
+
+#ifdef CONFIG_CGROUP_SCHED
+        if (!ret && write) {
+                struct task_group *tg;
+
+                rcu_read_lock();
+                list_for_each_entry_rcu(tg, &task_groups, list)
+                        tg_update_wrr_timeslice(tg);
+                rcu_read_unlock();
+        }
+#endif
+        mutex_unlock(&mutex);
+
+        return ret;
+}
+
+#ifdef CONFIG_SYSCTL
+/* 1ms to 10s */
+static int min_sched_wrr_timeslice_us = 1000;
+static int max_sched_wrr_timeslice_us = 10000000;
+static int zero;
+
+static struct ctl_table sched_wrr_sysctls[] = {
+        {
+                .procname        = "sched_wrr_fore_timeslice_us",
+                .data                = &sysctl_sched_wrr_fore_timeslice_us,
+                .maxlen                = sizeof(unsigned int),
+                .mode                = 0644,
+                .proc_handler        = sched_wrr_timeslice_handler,
+                .extra1                = &min_sched_wrr_timeslice_us,
+                .extra2                = &max_sched_wrr_timeslice_us,
+        },
+        {
+                .procname        = "sched_wrr_back_timeslice_us",
+                .data                = &sysctl_sched_wrr_back_timeslice_us,
+                .maxlen                = sizeof(unsigned int),
+                .mode                = 0644,
+                .proc_handler        = sched_wrr_timeslice_handler,
+                .extra1                = &min_sched_wrr_timeslice_us,
+                .extra2                = &max_sched_wrr_timeslice_us,
+        },
+        {
+                .procname        = "sched_wrr_wakeup_granularity_us",
+                .data                = &sysctl_sched_wrr_wakeup_granularity_us,
+                .maxlen                = sizeof(unsigned int),
+                .mode                = 0644,
+                .proc_handler        = proc_dointvec_minmax,
+                .extra1                = &zero,
+                .extra2                = &max_sched_wrr_timeslice_us,
+        },
+        {}
+};
+
+static struct ctl_table sched_wrr_sysctl_root[] = {
+        {
+                .procname        = "kernel",
+                .mode                = 0555,
+                .child                = sched_wrr_sysctls,
+        },
+        {}
+};
+
+/* kernel/sysctl.c is not touched by the WRR class, so register here */
+static int __init sched_wrr_sysctl_init(void)
+{
+        register_sysctl_table(sched_wrr_sysctl_root);
+        return 0;
+}
+late_initcall(sched_wrr_sysctl_init);
+#endif /* CONFIG_SYSCTL */
+
 #ifdef CONFIG_CGROUP_SCHED
 
 /* return corresponding task_group object of a cgroup */
@@ -7909,6 +8762,17 @@ static struct cgroup_subsys_state *cpu_cgroup_create(struct cgroup *cgrp)
         if (IS_ERR(tg))
                 return ERR_PTR(-ENOMEM);
 
+        /*
+         * A nested group has the class of its parent. A top-level group
+         * has no dentry yet, so it is classified by name once its
+         * directory exists, in cpu_cgroup_populate().
+         */
+        if (parent == &root_task_group)
+                tg->wrr_class = WRR_GROUP_FORE;
+        else
+                tg->wrr_class = parent->wrr_class;
+        tg_update_wrr_timeslice(tg);
+
         return &tg->css;
 }
 
@@ -7941,19 +8805,52 @@ static int cpu_cgroup_can_attach(struct cgroup *cgrp,
 {
         struct task_struct *task;
 
+        /*
+         * Runs under cgroup_mutex, like the chunk allocation for a task
+         * becoming SCHED_WRR in __sched_setscheduler(), so task->policy and
+         * task->rt_priority cannot change before cpu_cgroup_attach().
+         */
         cgroup_taskset_for_each(task, cgrp, tset) {
+                if (task->policy == SCHED_WRR &&
+                    alloc_wrr_prio_chunks(cgroup_tg(cgrp),
+                                          wrr_prio_level(task->rt_priority)))
+                        return -ENOMEM;
+                if (!sched_wrr_can_attach(cgroup_tg(cgrp), task))
+                        return -EINVAL;
 #ifdef CONFIG_RT_GROUP_SCHED
                 if (!sched_rt_can_attach(cgroup_tg(cgrp), task))
                         return -EINVAL;
 #else
                 /* We don't support RT-tasks being in separate groups */
-                if (task->sched_class != &fair_sched_class)
+                if (task->sched_class != &fair_sched_class &&
+                    task->sched_class != &wrr_sched_class)
                         return -EINVAL;
 #endif
         }
         return 0;
 }
 
+/*
+ * Classify a top-level cgroup for SCHED_WRR by its name: one starting
+ * with 'b' (e.g. /bg_non_interactive) is background, any other is
+ * foreground, and groups below it inherit its class when created.
+ * The class is fixed at creation; renaming a cgroup is not supported
+ * and leaves the group and its children with their old class.
+ */
+static int cgroup_wrr_class(struct cgroup *cgrp)
+{
+        struct dentry *dentry;
+        int class = WRR_GROUP_FORE;
+
+        rcu_read_lock();
+        dentry = rcu_dereference_check(cgrp->dentry, cgroup_lock_is_held());
+        if (dentry && dentry->d_name.name[0] == 'b')
+                class = WRR_GROUP_BACK;
+        rcu_read_unlock();
+
+        return class;
+}
+
 static void cpu_cgroup_attach(struct cgroup *cgrp,
                               struct cgroup_taskset *tset)
 {
@@ -7978,6 +8875,39 @@ cpu_cgroup_exit(struct cgroup *cgrp, struct cgroup *old_cgrp,
         sched_move_task(task);
 }
 
+static int cpu_wrr_weight_write_u64(struct cgroup *cgrp, struct cftype *cftype,
+                                    u64 weight)
+{
+        return sched_group_set_wrr_weight(cgroup_tg(cgrp), weight);
+}
+
+static u64 cpu_wrr_weight_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+        return (u64) cgroup_tg(cgrp)->wrr_weight;
+}
+
+static int cpu_wrr_runtime_write(struct cgroup *cgrp, struct cftype *cft,
+                                 s64 val)
+{
+        return sched_group_set_wrr_runtime(cgroup_tg(cgrp), val);
+}
+
+static s64 cpu_wrr_runtime_read(struct cgroup *cgrp, struct cftype *cft)
+{
+        return sched_group_wrr_runtime(cgroup_tg(cgrp));
+}
+
+static int cpu_wrr_period_write_uint(struct cgroup *cgrp, struct cftype *cftype,
+                u64 wrr_period_us)
+{
+        return sched_group_set_wrr_period(cgroup_tg(cgrp), wrr_period_us);
+}
+
+static u64 cpu_wrr_period_read_uint(struct cgroup *cgrp, struct cftype *cft)
+{
+        return sched_group_wrr_period(cgroup_tg(cgrp));
+}
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 static int cpu_shares_write_u64(struct cgroup *cgrp, struct cftype *cftype,
                                 u64 shareval)
@@ -8284,10 +9214,31 @@ static struct cftype cpu_files[] = {
                 .write_u64 = cpu_rt_period_write_uint,
         },
 #endif
+        {
+                .name = "wrr_weight",
+                .read_u64 = cpu_wrr_weight_read_u64,
+                .write_u64 = cpu_wrr_weight_write_u64,
+        },
+        {
+                .name = "wrr_runtime_us",
+                .read_s64 = cpu_wrr_runtime_read,
+                .write_s64 = cpu_wrr_runtime_write,
+        },
+        {
+                .name = "wrr_period_us",
+                .read_u64 = cpu_wrr_period_read_uint,
+                .write_u64 = cpu_wrr_period_write_uint,
+        },
 };
 
 static int cpu_cgroup_populate(struct cgroup_subsys *ss, struct cgroup *cont)
 {
+        /* The dentry of a new top-level group is set by now */
+        if (cont->parent && !cont->parent->parent) {
+                cgroup_tg(cont)->wrr_class = cgroup_wrr_class(cont);
+                tg_update_wrr_timeslice(cgroup_tg(cont));
+        }
+
         return cgroup_add_files(cont, ss, cpu_files, ARRAY_SIZE(cpu_files));
 }
 
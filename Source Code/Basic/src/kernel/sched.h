@@ -5,6 +5,7 @@
 #include <linux/stop_machine.h>
 
 #include "cpupri.h"
+#include "wrrpri.h"
 
 extern __read_mostly int scheduler_running;
 
@@ -76,13 +77,45 @@ struct rt_prio_array {
 };
 
 /*
- * This is the priority-queue data structure of the WRR scheduling class:
+ * This is the priority-queue data structure of the WRR scheduling class.
+ *
+ * The queue heads come in chunks of WRR_PRIO_CHUNK_SIZE levels which a
+ * group runqueue only gets once a task of that range may join the group
+ * (see alloc_wrr_prio_chunks()), so an unused group costs the bitmap and
+ * the chunk directory on every cpu instead of MAX_WRR_PRIO list heads.
+ * The root runqueue of every cpu has all chunks. Picking stays a bitmap
+ * search followed by a directory lookup.
  */
+#define WRR_PRIO_CHUNK_SIZE        10
+#define WRR_PRIO_CHUNKS                DIV_ROUND_UP(MAX_WRR_PRIO, WRR_PRIO_CHUNK_SIZE)
+
+struct wrr_prio_chunk {
+        struct list_head queue[WRR_PRIO_CHUNK_SIZE];
+};
+
 struct wrr_prio_array {
-        DECLARE_BITMAP(bitmap, MAX_WRR_PRIO+1);
-        struct list_head queue[MAX_WRR_PRIO];
+        DECLARE_BITMAP(bitmap, MAX_WRR_PRIO+1); /* include 1 bit for delimiter */
+        struct wrr_prio_chunk *chunk[WRR_PRIO_CHUNKS];
 };
 
+static inline struct list_head *wrr_prio_queue(struct wrr_prio_array *array, int prio)
+{
+        return &array->chunk[prio / WRR_PRIO_CHUNK_SIZE]->queue[prio % WRR_PRIO_CHUNK_SIZE];
+}
+
+/*
+ * Foreground/background class of a task group under SCHED_WRR. It is
+ * set when the cgroup is created, from the name of its top-level cgroup,
+ * so the tick path only reads tg->wrr_class instead of formatting the path.
+ */
+enum wrr_group_class {
+        WRR_GROUP_OTHER = 0,        /* root group and autogroups */
+        WRR_GROUP_FORE,
+        WRR_GROUP_BACK,
+};
+
+extern unsigned int sched_wrr_timeslice(int wrr_class, unsigned int weight);
+
 struct rt_bandwidth {
         /* nests inside the rq lock: */
         raw_spinlock_t                rt_runtime_lock;
@@ -91,6 +124,20 @@ struct rt_bandwidth {
         struct hrtimer                rt_period_timer;
 };
 
+/*
+ * WRR bandwidth of a task group: every wrr_rq of the group may run for
+ * wrr_runtime per wrr_period and is throttled once it has used it up.
+ */
+struct wrr_bandwidth {
+        /* nests inside the rq lock: */
+        raw_spinlock_t                wrr_runtime_lock;
+        ktime_t                        wrr_period;
+        u64                        wrr_runtime;
+        struct hrtimer                wrr_period_timer;
+};
+
+#define WRR_DEFAULT_PERIOD_US        1000000
+
 extern struct mutex sched_domains_mutex;
 
 #ifdef CONFIG_CGROUP_SCHED
@@ -146,6 +193,11 @@ struct task_group {
         struct sched_wrr_entity **wrr_se;
         struct wrr_rq **wrr_rq;
 // #endif
+        struct wrr_bandwidth wrr_bandwidth;
+        int wrr_class;
+        unsigned int wrr_weight;        /* cpu.wrr_weight */
+        /* slice in jiffies, derived from wrr_class and wrr_weight */
+        unsigned int wrr_timeslice;
 
         struct rcu_head rcu;
         struct list_head list;
@@ -207,6 +259,11 @@ extern void init_tg_cfs_entry(struct task_group *tg, struct cfs_rq *cfs_rq,
                         struct sched_entity *parent);
 extern void init_cfs_bandwidth(struct cfs_bandwidth *cfs_b);
 extern int sched_group_set_shares(struct task_group *tg, unsigned long shares);
+extern int sched_group_set_wrr_weight(struct task_group *tg, unsigned long weight);
+extern int sched_group_set_wrr_runtime(struct task_group *tg, long wrr_runtime_us);
+extern long sched_group_wrr_runtime(struct task_group *tg);
+extern int sched_group_set_wrr_period(struct task_group *tg, long wrr_period_us);
+extern long sched_group_wrr_period(struct task_group *tg);
 
 extern void __refill_cfs_bandwidth_runtime(struct cfs_bandwidth *cfs_b);
 extern void __start_cfs_bandwidth(struct cfs_bandwidth *cfs_b);
@@ -222,6 +279,8 @@ extern void init_tg_rt_entry(struct task_group *tg, struct rt_rq *rt_rq,
 extern void init_tg_wrr_entry(struct task_group *tg, struct wrr_rq *wrr_rq,
                 struct sched_wrr_entity *wrr_se, int cpu,
                 struct sched_wrr_entity *parent);
+extern int alloc_wrr_prio_chunks(struct task_group *tg, int prio);
+extern void free_wrr_prio_chunks(struct wrr_prio_array *array);
 
 #else /* CONFIG_CGROUP_SCHED */
 
@@ -340,10 +399,20 @@ struct rt_rq {
 #endif
 };
 
-/* Wrr classes' related field in a runqueue: */
+/*
+ * Wrr classes' related field in a runqueue.
+ *
+ * The first cache line (the first two with 32-byte lines) holds
+ * everything enqueue, dequeue and pick_next touch, and the counters
+ * remote cpus read when placing and balancing tasks: the run counters,
+ * highest_prio and the occupied-level bitmap.
+ * Schedstats are written on every pick and live on a line of their own
+ * so they do not bounce the first line between cpus.
+ */
 struct wrr_rq {
-        struct wrr_prio_array active;
         unsigned long wrr_nr_running;
+        /* sum of the slice weights of all queued entities */
+        unsigned long wrr_weight;
 // #if defined CONFIG_SMP || defined CONFIG_WRR_GROUP_SCHED
         struct {
                 int curr; //highest queued wrr task prio
@@ -352,12 +421,37 @@ struct wrr_rq {
 #endif
         } highest_prio;
 // #endif
-// #ifdef CONFIG_WRR_GROUP_SCHED
+        int wrr_throttled;
+        /* bitmap first, so it shares the line with the counters above */
+        struct wrr_prio_array active;
         struct rq *rq;
+#ifdef CONFIG_SMP
+        unsigned long wrr_nr_migratory;
+        unsigned long wrr_nr_total;
+        int overloaded;
+        struct plist_head pushable_tasks;
+        unsigned long next_balance;        /* in jiffies */
+#endif
+// #ifdef CONFIG_WRR_GROUP_SCHED
         struct list_head leaf_wrr_rq_list;
         struct task_group *tg;
 // #endif
-};
+        /* runtime used in this period, and what this cpu may use */
+        u64 wrr_time;
+        u64 wrr_runtime;
+        /* Nests inside the rq lock: */
+        raw_spinlock_t wrr_runtime_lock;
+#ifdef CONFIG_SCHEDSTATS
+        /* counted on the cpu's root wrr_rq only */
+        u64 wrr_wait_sum ____cacheline_aligned_in_smp;
+        unsigned int wrr_wait_count;
+        unsigned int wrr_nr_slice_expired;
+        unsigned int wrr_nr_voluntary;
+        unsigned int wrr_nr_involuntary;
+        unsigned int wrr_nr_prio_changes;
+        unsigned int wrr_nr_migrations;
+#endif
+} ____cacheline_aligned_in_smp;
 
 #ifdef CONFIG_SMP
 
@@ -382,6 +476,14 @@ struct root_domain {
          */
         cpumask_var_t rto_mask;
         struct cpupri cpupri;
+
+        /*
+         * The "WRR overload" flag: it gets set if a CPU has more than
+         * one runnable WRR task and at least one of them may migrate.
+         */
+        atomic_t wrro_count;
+        cpumask_var_t wrro_mask;
+        struct wrrpri wrrpri;
 };
 
 extern struct root_domain def_root_domain;
@@ -579,6 +681,91 @@ static inline struct sched_domain *highest_flag_domain(int cpu, int flag)
 DECLARE_PER_CPU(struct sched_domain *, sd_llc);
 DECLARE_PER_CPU(int, sd_llc_id);
 
+/*
+ * A cpu on another NUMA node must be this much lighter, in percent, to
+ * take a WRR task, or this much heavier to have one pulled from it.
+ */
+#define WRR_NUMA_IMBALANCE_PCT  200
+
+/*
+ * Whether @sd reaches beyond the NUMA node of @cpu. This tree has no
+ * SD_NUMA flag, so go by the span of the domain.
+ */
+static inline int sd_spans_nodes(struct sched_domain *sd, int cpu)
+{
+        return !cpumask_subset(sched_domain_span(sd),
+                               cpumask_of_node(cpu_to_node(cpu)));
+}
+
+/* Whether @cpu was already seen on the level below @sd in a bottom-up walk */
+static inline int sd_child_has_cpu(struct sched_domain *sd, int cpu)
+{
+        return sd->child && cpumask_test_cpu(cpu, sched_domain_span(sd->child));
+}
+
+/*
+ * select_task_rq() of every WRR class: the allowed cpu with the least
+ * @load, or -1 when none is active. The sched domains of @prev_cpu are
+ * walked from the innermost out, so that cpus sharing its last-level
+ * cache are looked at first and win ties, and the first idle cpu found is
+ * taken outright. A cpu on another NUMA node has to beat the best one so
+ * far by WRR_NUMA_IMBALANCE_PCT, as @p leaves its cache and its memory
+ * behind there.
+ */
+static inline int wrr_find_lightest_cpu(struct task_struct *p, int prev_cpu,
+                                        unsigned long (*load)(int cpu))
+{
+        struct sched_domain *sd;
+        unsigned long cpu_load, min_load = ULONG_MAX;
+        unsigned int pct;
+        int cpu, idle, best_cpu = -1;
+
+        if (cpumask_test_cpu(prev_cpu, tsk_cpus_allowed(p)) && cpu_active(prev_cpu)) {
+                min_load = load(prev_cpu);
+                best_cpu = prev_cpu;
+        }
+
+        rcu_read_lock();
+        for_each_domain(prev_cpu, sd) {
+                pct = sd_spans_nodes(sd, prev_cpu) ? WRR_NUMA_IMBALANCE_PCT : 100;
+
+                for_each_cpu_and(cpu, sched_domain_span(sd), tsk_cpus_allowed(p)) {
+                        if (cpu == prev_cpu || !cpu_active(cpu) || sd_child_has_cpu(sd, cpu))
+                                continue;
+
+                        cpu_load = load(cpu);
+                        idle = idle_cpu(cpu);
+                        if (best_cpu != -1 && !(idle && pct == 100) &&
+                            cpu_load * pct >= min_load * 100)
+                                continue;
+
+                        min_load = cpu_load;
+                        best_cpu = cpu;
+                        if (idle)
+                                goto out;
+                }
+        }
+out:
+        rcu_read_unlock();
+
+        if (best_cpu != -1)
+                return best_cpu;
+
+        /* @prev_cpu went offline or has no domains, fall back to a flat scan */
+        for_each_cpu_and(cpu, tsk_cpus_allowed(p), cpu_active_mask) {
+                if (idle_cpu(cpu))
+                        return cpu;
+
+                cpu_load = load(cpu);
+                if (cpu_load < min_load) {
+                        min_load = cpu_load;
+                        best_cpu = cpu;
+                }
+        }
+
+        return best_cpu;
+}
+
 #endif /* CONFIG_SMP */
 
 #include "stats.h"
@@ -604,10 +791,28 @@ static inline struct task_group *task_group(struct task_struct *p)
         return p->sched_task_group;
 }
 
+static inline int task_wrr_class(struct task_struct *p)
+{
+        return task_group(p)->wrr_class;
+}
+
+/* The SCHED_WRR timeslice of @p in jiffies */
+static inline unsigned int task_wrr_timeslice(struct task_struct *p)
+{
+        return task_group(p)->wrr_timeslice;
+}
+
+/* The cpu.wrr_weight of @p's group */
+static inline unsigned int task_wrr_weight(struct task_struct *p)
+{
+        return task_group(p)->wrr_weight;
+}
+
 /* Change a task's cfs_rq and parent entity if it moves across CPUs/groups */
 static inline void set_task_rq(struct task_struct *p, unsigned int cpu)
 {
-#if defined(CONFIG_FAIR_GROUP_SCHED) || defined(CONFIG_RT_GROUP_SCHED)
+#if defined(CONFIG_FAIR_GROUP_SCHED) || defined(CONFIG_RT_GROUP_SCHED) || \
+    defined(CONFIG_WRR_GROUP_SCHED)
         struct task_group *tg = task_group(p);
 #endif
 
@@ -635,8 +840,115 @@ static inline struct task_group *task_group(struct task_struct *p)
         return NULL;
 }
 
+static inline int task_wrr_class(struct task_struct *p)
+{
+        return WRR_GROUP_OTHER;
+}
+
+static inline unsigned int task_wrr_timeslice(struct task_struct *p)
+{
+        return sched_wrr_timeslice(WRR_GROUP_OTHER, WRR_DEFAULT_WEIGHT);
+}
+
+static inline unsigned int task_wrr_weight(struct task_struct *p)
+{
+        return WRR_DEFAULT_WEIGHT;
+}
+
 #endif /* CONFIG_CGROUP_SCHED */
 
+/*
+ * SCHED_WRR priority order, shared by every WRR class: a queued task sits
+ * on a level in [0, MAX_WRR_PRIO) and pick_next_task_wrr() runs the lowest
+ * occupied level first, round robin within a level.
+ */
+static inline int wrr_level_before(int a, int b)
+{
+        return a < b;
+}
+
+/*
+ * The level a SCHED_WRR task of @rt_priority is queued at, or starts out
+ * at in RMLFQ, which moves it between stages later. As for SCHED_FIFO and
+ * SCHED_RR, a higher rt_priority runs first.
+ */
+static inline int wrr_prio_level(unsigned int rt_priority)
+{
+        return MAX_WRR_PRIO - 1 - rt_priority;
+}
+
+/*
+ * Should @p, waking on level @p_level, preempt @curr on level @curr_level?
+ * A foreground wakeup always preempts a background task. Otherwise @p has
+ * to run on an earlier level, or on the same one when it was boosted to
+ * the head of it and @curr was not, and a @curr with no more than
+ * sysctl_sched_wrr_wakeup_granularity_us of its slice left is let finish,
+ * as it gives up the cpu shortly anyway.
+ */
+static inline int wrr_wakeup_preempt(struct task_struct *curr, int curr_level,
+                                     struct task_struct *p, int p_level)
+{
+        if (task_wrr_class(curr) == WRR_GROUP_BACK &&
+            task_wrr_class(p) != WRR_GROUP_BACK)
+                return 1;
+
+        if (!wrr_level_before(p_level, curr_level) &&
+            !(p_level == curr_level && p->wrr.boosted && !curr->wrr.boosted))
+                return 0;
+
+        return jiffies_to_usecs(curr->wrr.time_slice) >
+                sysctl_sched_wrr_wakeup_granularity_us;
+}
+
+#ifdef CONFIG_SCHEDSTATS
+
+/*
+ * WRR run delay: the time a task spends queued on a wrr_prio_array
+ * without running. It is charged to the task and to its cpu.
+ */
+static inline void wrr_stats_wait_start(struct rq *rq, struct task_struct *p)
+{
+        p->wrr.statistics.wait_start = rq->clock;
+}
+
+static inline void wrr_stats_wait_end(struct rq *rq, struct task_struct *p)
+{
+        struct sched_wrr_statistics *stats = &p->wrr.statistics;
+        u64 delta;
+
+        if (!stats->wait_start)
+                return;
+
+        delta = rq->clock - stats->wait_start;
+        stats->wait_max = max(stats->wait_max, delta);
+        stats->wait_count++;
+        stats->wait_sum += delta;
+        stats->wait_start = 0;
+
+        rq->wrr.wrr_wait_count++;
+        rq->wrr.wrr_wait_sum += delta;
+}
+
+/* @p stops running; it switched voluntarily if it is no longer queued */
+static inline void wrr_stats_switch_out(struct rq *rq, struct task_struct *p)
+{
+        if (p->on_rq) {
+                p->wrr.statistics.nr_involuntary_switches++;
+                rq->wrr.wrr_nr_involuntary++;
+        } else {
+                p->wrr.statistics.nr_voluntary_switches++;
+                rq->wrr.wrr_nr_voluntary++;
+        }
+}
+
+#else /* CONFIG_SCHEDSTATS */
+
+static inline void wrr_stats_wait_start(struct rq *rq, struct task_struct *p) { }
+static inline void wrr_stats_wait_end(struct rq *rq, struct task_struct *p) { }
+static inline void wrr_stats_switch_out(struct rq *rq, struct task_struct *p) { }
+
+#endif /* CONFIG_SCHEDSTATS */
+
 static inline void __set_task_cpu(struct task_struct *p, unsigned int cpu)
 {
         set_task_rq(p, cpu);
@@ -908,7 +1220,9 @@ extern const struct sched_class wrr_sched_class;
 #ifdef CONFIG_SMP
 
 extern void trigger_load_balance(struct rq *rq, int cpu);
+extern void trigger_wrr_load_balance(struct rq *rq, int cpu);
 extern void idle_balance(int this_cpu, struct rq *this_rq);
+extern void idle_pull_wrr_task(struct rq *this_rq);
 
 #else        /* CONFIG_SMP */
 
@@ -916,6 +1230,10 @@ static inline void idle_balance(int cpu, struct rq *rq)
 {
 }
 
+static inline void idle_pull_wrr_task(struct rq *this_rq)
+{
+}
+
 #endif
 
 extern void sysrq_sched_debug_show(void);
@@ -925,6 +1243,7 @@ extern void update_group_power(struct sched_domain *sd, int cpu);
 extern int update_runtime(struct notifier_block *nfb, unsigned long action, void *hcpu);
 extern void init_sched_rt_class(void);
 extern void init_sched_fair_class(void);
+extern void init_sched_wrr_class(void);
 
 extern void resched_task(struct task_struct *p);
 extern void resched_cpu(int cpu);
@@ -932,6 +1251,59 @@ extern void resched_cpu(int cpu);
 extern struct rt_bandwidth def_rt_bandwidth;
 extern void init_rt_bandwidth(struct rt_bandwidth *rt_b, u64 period, u64 runtime);
 
+extern void init_wrr_bandwidth(struct wrr_bandwidth *wrr_b, u64 period, u64 runtime);
+extern void destroy_wrr_bandwidth(struct wrr_bandwidth *wrr_b);
+extern int sched_wrr_charge_runtime(struct wrr_rq *wrr_rq, u64 delta_exec);
+extern void enable_wrr_runtime(struct rq *rq);
+extern void disable_wrr_runtime(struct rq *rq);
+
+/*
+ * Provided by the WRR class: take a throttled wrr_rq off the cpu and put
+ * it back once the period timer has refilled its runtime.
+ */
+extern void sched_wrr_rq_dequeue(struct wrr_rq *wrr_rq);
+extern void sched_wrr_rq_enqueue(struct wrr_rq *wrr_rq);
+
+static inline int wrr_rq_throttled(struct wrr_rq *wrr_rq)
+{
+        return wrr_rq->wrr_throttled;
+}
+
+/*
+ * task_fork() of every WRR class: split the parent's remaining slice with
+ * the child @p, as the O(1) scheduler did, so that forking cannot mint
+ * fresh slices and multiply the parent's share. The child gets the rounded
+ * up half. A parent left with nothing has used up its slice, so it goes to
+ * the tail of its level with a fresh one and gives up the cpu, as at the
+ * tick that ends a slice. The child is enqueued by wake_up_new_task() at
+ * the tail of its level.
+ */
+static inline void wrr_task_fork(struct task_struct *p)
+{
+        struct task_struct *parent = current;
+        struct rq *rq = this_rq();
+        unsigned long flags;
+
+        raw_spin_lock_irqsave(&rq->lock, flags);
+
+        if (parent->sched_class != &wrr_sched_class) {
+                p->wrr.time_slice = p->sched_class->get_rr_interval(rq, p);
+                goto out;
+        }
+
+        p->wrr.time_slice = (parent->wrr.time_slice + 1) >> 1;
+        parent->wrr.time_slice >>= 1;
+        if (!parent->wrr.time_slice) {
+                parent->sched_class->yield_task(rq);
+                parent->wrr.time_slice =
+                        parent->sched_class->get_rr_interval(rq, parent);
+                parent->wrr.boosted = 0;
+                set_tsk_need_resched(parent);
+        }
+out:
+        raw_spin_unlock_irqrestore(&rq->lock, flags);
+}
+
 extern void update_cpu_load(struct rq *this_rq);
 
 #ifdef CONFIG_CGROUP_CPUACCT
@@ -5,21 +5,15 @@
 #include "sched.h"
 #include <linux/slab.h>
 
-// To determine whether the process is in foreground or background
-static char group_path[10000];
-static char *task_group_path(struct task_group *tg)
-{
-    if (autogroup_path(tg, group_path, 10000))
-        return group_path;
+#define CREATE_TRACE_POINTS
+#include <trace/events/sched_wrr.h>
 
-    if (!tg->css.cgroup)
-    {
-        group_path[0] = '\0';
-        return group_path;
-    }
-    cgroup_path(tg->css.cgroup, group_path, 10000);
-    return group_path;
-}
+/* Only try to find a target runqueue for a pushed task three times */
+#define WRR_MAX_TRIES           3
+/* How often each cpu compares its WRR weight against the busiest cpu */
+#define WRR_BALANCE_INTERVAL    msecs_to_jiffies(50)
+/* The busiest cpu must carry this much more weight, in percent, to be pulled from */
+#define WRR_IMBALANCE_PCT       125
 
 static inline struct task_struct *wrr_task_of(struct sched_wrr_entity *wrr_se)
 {
@@ -41,7 +35,81 @@ static inline struct wrr_rq *wrr_rq_of_se(struct sched_wrr_entity *wrr_se)
 
 static inline int wrr_se_prio(struct sched_wrr_entity *wrr_se)
 {
-    return wrr_task_of(wrr_se)->rt_priority;
+    return wrr_prio_level(wrr_task_of(wrr_se)->rt_priority);
+}
+
+static inline int wrr_task_prio(struct task_struct *p)
+{
+    return wrr_se_prio(&p->wrr);
+}
+
+/*
+ * A foreground task is interactive when, on average, it sleeps at least
+ * WRR_INTERACTIVE_RATIO times as long as it runs between two wakeups and
+ * its bursts stay under half its slice. It then wakes up at the head of
+ * its level instead of the tail and may preempt the task running on that
+ * level, see wrr_wakeup_preempt(), unless another boosted task is already
+ * there, so boosted tasks cannot crowd out the rest of a level.
+ */
+#define WRR_INTERACTIVE_RATIO 4
+
+/* Fold one run burst and the sleep after it into @wrr_se's averages */
+static void wrr_update_interactivity(struct rq *rq, struct task_struct *p)
+{
+    struct sched_wrr_entity *wrr_se = &p->wrr;
+    u64 run = p->se.sum_exec_runtime - wrr_se->fb_exec_start;
+    s64 sleep = local_clock() - wrr_se->fb_sleep_start;
+
+    if (sleep < 0)
+        sleep = 0;
+
+    wrr_se->avg_run += (run >> 2) - (wrr_se->avg_run >> 2);
+    wrr_se->avg_sleep += ((u64)sleep >> 2) - (wrr_se->avg_sleep >> 2);
+
+    wrr_se->fb_exec_start = p->se.sum_exec_runtime;
+    wrr_se->fb_sleep_start = 0;
+}
+
+static int wrr_task_interactive(struct task_struct *p)
+{
+    struct sched_wrr_entity *wrr_se = &p->wrr;
+    u64 half_slice;
+
+    if (task_wrr_class(p) == WRR_GROUP_BACK)
+        return 0;
+
+    half_slice = (u64)jiffies_to_usecs(task_wrr_timeslice(p)) * NSEC_PER_USEC / 2;
+
+    return wrr_se->avg_run * WRR_INTERACTIVE_RATIO <= wrr_se->avg_sleep &&
+           wrr_se->avg_run < half_slice;
+}
+
+/* Whether the woken @p may go to the head of its level */
+static int wrr_wakeup_boost(struct rq *rq, struct task_struct *p)
+{
+    struct list_head *queue = wrr_prio_queue(&rq->wrr.active, wrr_task_prio(p));
+    struct sched_wrr_entity *head;
+
+    if (!wrr_task_interactive(p))
+        return 0;
+
+    if (!list_empty(queue))
+    {
+        head = list_first_entry(queue, struct sched_wrr_entity, run_list);
+        if (head->boosted)
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * A task loads its runqueue by the slice it is given every round, so the
+ * weights follow the tier timeslices and the group's cpu.wrr_weight.
+ */
+static inline unsigned int wrr_task_weight(struct task_struct *p)
+{
+    return task_wrr_timeslice(p);
 }
 
 /*
@@ -68,6 +136,186 @@ static void update_curr_wrr(struct rq *rq)
 
     curr->se.exec_start = rq->clock_task;
     cpuacct_charge(curr, delta_exec);
+
+    if (sched_wrr_charge_runtime(&rq->wrr, delta_exec))
+        resched_task(curr);
+}
+
+/*
+ * Only the root wrr_rq is charged, and pick_next_task_wrr() leaves it
+ * alone while it is throttled, so there is nothing to take off the cpu.
+ */
+void sched_wrr_rq_dequeue(struct wrr_rq *wrr_rq)
+{
+}
+
+void sched_wrr_rq_enqueue(struct wrr_rq *wrr_rq)
+{
+    if (wrr_rq->wrr_nr_running)
+        resched_task(rq_of_wrr_rq(wrr_rq)->curr);
+}
+
+#ifdef CONFIG_SMP
+
+static inline int wrr_overloaded(struct rq *rq)
+{
+    return atomic_read(&rq->rd->wrro_count);
+}
+
+static inline void wrr_set_overload(struct rq *rq)
+{
+    if (!rq->online)
+        return;
+
+    cpumask_set_cpu(rq->cpu, rq->rd->wrro_mask);
+    /*
+     * Make sure the mask is visible before we set the overload count,
+     * which is checked to determine if we should look at the mask.
+     */
+    wmb();
+    atomic_inc(&rq->rd->wrro_count);
+}
+
+static inline void wrr_clear_overload(struct rq *rq)
+{
+    if (!rq->online)
+        return;
+
+    /* the order here really doesn't matter */
+    atomic_dec(&rq->rd->wrro_count);
+    cpumask_clear_cpu(rq->cpu, rq->rd->wrro_mask);
+}
+
+static void update_wrr_migration(struct wrr_rq *wrr_rq)
+{
+    if (wrr_rq->wrr_nr_migratory && wrr_rq->wrr_nr_total > 1)
+    {
+        if (!wrr_rq->overloaded)
+        {
+            wrr_set_overload(rq_of_wrr_rq(wrr_rq));
+            wrr_rq->overloaded = 1;
+        }
+    }
+    else if (wrr_rq->overloaded)
+    {
+        wrr_clear_overload(rq_of_wrr_rq(wrr_rq));
+        wrr_rq->overloaded = 0;
+    }
+}
+
+static void inc_wrr_migration(struct task_struct *p, struct wrr_rq *wrr_rq)
+{
+    wrr_rq->wrr_nr_total++;
+    if (p->rt.nr_cpus_allowed > 1)
+        wrr_rq->wrr_nr_migratory++;
+
+    update_wrr_migration(wrr_rq);
+}
+
+static void dec_wrr_migration(struct task_struct *p, struct wrr_rq *wrr_rq)
+{
+    wrr_rq->wrr_nr_total--;
+    if (p->rt.nr_cpus_allowed > 1)
+        wrr_rq->wrr_nr_migratory--;
+
+    update_wrr_migration(wrr_rq);
+}
+
+static inline void wrr_stats_migrate(struct rq *dst_rq, struct task_struct *p)
+{
+    schedstat_inc(p, wrr.statistics.nr_migrations);
+    schedstat_inc(dst_rq, wrr.wrr_nr_migrations);
+}
+
+static inline int has_pushable_wrr_tasks(struct rq *rq)
+{
+    return !plist_head_empty(&rq->wrr.pushable_tasks);
+}
+
+static void enqueue_pushable_wrr_task(struct rq *rq, struct task_struct *p)
+{
+    plist_del(&p->wrr.pushable_tasks, &rq->wrr.pushable_tasks);
+    plist_node_init(&p->wrr.pushable_tasks, wrr_task_prio(p));
+    plist_add(&p->wrr.pushable_tasks, &rq->wrr.pushable_tasks);
+
+    /* Update the highest prio pushable task */
+    if (wrr_task_prio(p) < rq->wrr.highest_prio.next)
+        rq->wrr.highest_prio.next = wrr_task_prio(p);
+}
+
+static void dequeue_pushable_wrr_task(struct rq *rq, struct task_struct *p)
+{
+    plist_del(&p->wrr.pushable_tasks, &rq->wrr.pushable_tasks);
+
+    /* Update the new highest prio pushable task */
+    if (has_pushable_wrr_tasks(rq))
+    {
+        p = plist_first_entry(&rq->wrr.pushable_tasks,
+                              struct task_struct, wrr.pushable_tasks);
+        rq->wrr.highest_prio.next = wrr_task_prio(p);
+    }
+    else
+        rq->wrr.highest_prio.next = MAX_WRR_PRIO;
+}
+
+#else
+
+static inline void inc_wrr_migration(struct task_struct *p, struct wrr_rq *wrr_rq) {}
+
+static inline void dec_wrr_migration(struct task_struct *p, struct wrr_rq *wrr_rq) {}
+
+static inline void enqueue_pushable_wrr_task(struct rq *rq, struct task_struct *p) {}
+
+static inline void dequeue_pushable_wrr_task(struct rq *rq, struct task_struct *p) {}
+
+#endif /* CONFIG_SMP */
+
+#ifdef CONFIG_SMP
+
+static void inc_wrr_prio_smp(struct wrr_rq *wrr_rq, int prio, int prev_prio)
+{
+    struct rq *rq = rq_of_wrr_rq(wrr_rq);
+
+    if (rq->online && prio < prev_prio)
+        wrrpri_set(&rq->rd->wrrpri, rq->cpu, prio);
+}
+
+static void dec_wrr_prio_smp(struct wrr_rq *wrr_rq, int prio, int prev_prio)
+{
+    struct rq *rq = rq_of_wrr_rq(wrr_rq);
+
+    if (rq->online && wrr_rq->highest_prio.curr != prev_prio)
+        wrrpri_set(&rq->rd->wrrpri, rq->cpu, wrr_rq->highest_prio.curr);
+}
+
+#else /* CONFIG_SMP */
+
+static inline void inc_wrr_prio_smp(struct wrr_rq *wrr_rq, int prio, int prev_prio) {}
+
+static inline void dec_wrr_prio_smp(struct wrr_rq *wrr_rq, int prio, int prev_prio) {}
+
+#endif /* CONFIG_SMP */
+
+static void inc_wrr_prio(struct wrr_rq *wrr_rq, int prio)
+{
+    int prev_prio = wrr_rq->highest_prio.curr;
+
+    if (prio < prev_prio)
+        wrr_rq->highest_prio.curr = prio;
+
+    inc_wrr_prio_smp(wrr_rq, prio, prev_prio);
+}
+
+static void dec_wrr_prio(struct wrr_rq *wrr_rq, int prio)
+{
+    int prev_prio = wrr_rq->highest_prio.curr;
+
+    if (!wrr_rq->wrr_nr_running)
+        wrr_rq->highest_prio.curr = MAX_WRR_PRIO;
+    else if (prio == prev_prio)
+        wrr_rq->highest_prio.curr = sched_find_first_bit(wrr_rq->active.bitmap);
+
+    dec_wrr_prio_smp(wrr_rq, prio, prev_prio);
 }
 
 static inline void list_del_leaf_wrr_rq(struct wrr_rq *wrr_rq)
@@ -81,11 +329,13 @@ static void dequeue_wrr_entity(struct sched_wrr_entity *wrr_se)
     struct wrr_prio_array *array = &wrr_rq->active;
 
     list_del_init(&wrr_se->run_list);
-    if (list_empty(array->queue + wrr_se_prio(wrr_se)))
+    if (list_empty(wrr_prio_queue(array, wrr_se_prio(wrr_se))))
         __clear_bit(wrr_se_prio(wrr_se), array->bitmap);
 
     WARN_ON(!wrr_rq->wrr_nr_running);
     wrr_rq->wrr_nr_running--;
+    wrr_rq->wrr_weight -= wrr_se->weight;
+    dec_wrr_prio(wrr_rq, wrr_se_prio(wrr_se));
 
     if (!wrr_rq->wrr_nr_running)
         list_del_leaf_wrr_rq(wrr_rq);
@@ -93,12 +343,24 @@ static void dequeue_wrr_entity(struct sched_wrr_entity *wrr_se)
 
 static void dequeue_task_wrr(struct rq *rq, struct task_struct *p, int flags)
 {
-    printk("Dequeue a wrr task!\n");
-
     struct sched_wrr_entity *wrr_se = &p->wrr;
 
+    trace_sched_wrr_dequeue(p, wrr_se_prio(wrr_se), task_wrr_class(p));
+
     update_curr_wrr(rq);
+    wrr_stats_wait_end(rq, p);
     dequeue_wrr_entity(wrr_se);
+    dec_wrr_migration(p, &rq->wrr);
+
+    /*
+     * The task may wake on another cpu, whose rq->clock is not comparable
+     * with ours, so the sleep is timed with local_clock() on both ends.
+     */
+    wrr_se->boosted = 0;
+    if (flags & DEQUEUE_SLEEP)
+        wrr_se->fb_sleep_start = local_clock();
+
+    dequeue_pushable_wrr_task(rq, p);
 
     dec_nr_running(rq);
 }
@@ -113,7 +375,7 @@ static void enqueue_wrr_entity(struct sched_wrr_entity *wrr_se, bool head)
 {
     struct wrr_rq *wrr_rq = wrr_rq_of_se(wrr_se);
     struct wrr_prio_array *array = &wrr_rq->active;
-    struct list_head *queue = array->queue + wrr_se_prio(wrr_se);
+    struct list_head *queue = wrr_prio_queue(array, wrr_se_prio(wrr_se));
 
     if (!wrr_rq->wrr_nr_running)
         list_add_leaf_wrr_rq(wrr_rq);
@@ -125,7 +387,10 @@ static void enqueue_wrr_entity(struct sched_wrr_entity *wrr_se, bool head)
 
     __set_bit(wrr_se_prio(wrr_se), array->bitmap);
 
+    wrr_se->weight = wrr_task_weight(wrr_task_of(wrr_se));
     wrr_rq->wrr_nr_running++;
+    wrr_rq->wrr_weight += wrr_se->weight;
+    inc_wrr_prio(wrr_rq, wrr_se_prio(wrr_se));
 }
 
 /*
@@ -133,11 +398,29 @@ static void enqueue_wrr_entity(struct sched_wrr_entity *wrr_se, bool head)
  */
 static void enqueue_task_wrr(struct rq *rq, struct task_struct *p, int flags)
 {
-    printk("Enqueue a new wrr task!\n");
     struct sched_wrr_entity *wrr_se = &p->wrr;
 
-    // printk("%d", p->rt_priority);
+    if ((flags & ENQUEUE_WAKEUP) && wrr_se->fb_sleep_start)
+    {
+        wrr_update_interactivity(rq, p);
+
+        if (wrr_wakeup_boost(rq, p))
+        {
+            flags |= ENQUEUE_HEAD;
+            wrr_se->boosted = 1;
+            schedstat_inc(p, wrr.statistics.nr_wakeup_boosts);
+        }
+    }
+
     enqueue_wrr_entity(wrr_se, flags & ENQUEUE_HEAD);
+    trace_sched_wrr_enqueue(p, wrr_se_prio(wrr_se), task_wrr_class(p));
+    inc_wrr_migration(p, &rq->wrr);
+
+    if (!task_current(rq, p))
+        wrr_stats_wait_start(rq, p);
+
+    if (!task_current(rq, p) && p->rt.nr_cpus_allowed > 1)
+        enqueue_pushable_wrr_task(rq, p);
 
     inc_nr_running(rq);
 }
@@ -148,22 +431,22 @@ static void enqueue_task_wrr(struct rq *rq, struct task_struct *p, int flags)
  */
 static void requeue_task_wrr(struct rq *rq, struct task_struct *p, int head)
 {
-    printk("Requeue the tasks!\n");
     struct sched_wrr_entity *wrr_se = &p->wrr;
     struct wrr_rq *wrr_rq = &rq->wrr;
 
     struct wrr_prio_array *array = &wrr_rq->active;
-    struct list_head *queue = array->queue + wrr_se_prio(wrr_se);
+    struct list_head *queue = wrr_prio_queue(array, wrr_se_prio(wrr_se));
 
     if (head)
         list_move(&wrr_se->run_list, queue);
     else
         list_move_tail(&wrr_se->run_list, queue);
+
+    trace_sched_wrr_requeue(p, wrr_se_prio(wrr_se), task_wrr_class(p));
 }
 
 static void yield_task_wrr(struct rq *rq)
 {
-    printk("Yield a wrr task!\n");
     requeue_task_wrr(rq, rq->curr, 0);
 }
 
@@ -172,8 +455,13 @@ static void yield_task_wrr(struct rq *rq)
  */
 static void check_preempt_curr_wrr(struct rq *rq, struct task_struct *p, int flags)
 {
-    printk("Check wrr task preemption!\n");
-    if (p->rt_priority > rq->curr->rt_priority)
+    struct task_struct *curr = rq->curr;
+    int preempt = wrr_wakeup_preempt(curr, wrr_task_prio(curr),
+                                     p, wrr_task_prio(p));
+
+    trace_sched_wrr_check_preempt(rq->curr, p, preempt);
+
+    if (preempt)
     {
         resched_task(rq->curr);
         return;
@@ -184,7 +472,7 @@ static struct task_struct *pick_next_task_wrr(struct rq *rq)
 {
     // printk("Select next wrr task!\n");
 
-    if (unlikely(!rq->wrr.wrr_nr_running))
+    if (unlikely(!rq->wrr.wrr_nr_running || wrr_rq_throttled(&rq->wrr)))
         return NULL;
 
     struct wrr_rq *wrr_rq = &rq->wrr;
@@ -196,7 +484,7 @@ static struct task_struct *pick_next_task_wrr(struct rq *rq)
     idx = sched_find_first_bit(array->bitmap);
     BUG_ON(idx >= MAX_WRR_PRIO);
 
-    queue = array->queue + idx;
+    queue = wrr_prio_queue(array, idx);
     next = list_entry(queue->next, struct sched_wrr_entity, run_list);
 
     struct task_struct *p;
@@ -205,30 +493,58 @@ static struct task_struct *pick_next_task_wrr(struct rq *rq)
     if (!p)
         return NULL;
     p->se.exec_start = rq->clock_task;
+    wrr_stats_wait_end(rq, p);
+
+    /* The running task is never eligible for pushing */
+    dequeue_pushable_wrr_task(rq, p);
+
+#ifdef CONFIG_SMP
+    /*
+     * We detect this state here so that we can avoid taking the RQ
+     * lock again later if there is no need to push
+     */
+    rq->post_schedule = has_pushable_wrr_tasks(rq);
+#endif
 
     return p;
 }
 
 static void put_prev_task_wrr(struct rq *rq, struct task_struct *p)
 {
-    printk("Put previous wrr task!\n");
+    trace_sched_wrr_put_prev(p, wrr_task_prio(p), task_wrr_class(p));
+
     update_curr_wrr(rq);
+    wrr_stats_switch_out(rq, p);
     // p->se.exec_start = 0;
+
+    if (p->on_rq)
+        wrr_stats_wait_start(rq, p);
+
+    /*
+     * The previous task needs to be made eligible for pushing
+     * if it is still active
+     */
+    if (p->on_rq && p->rt.nr_cpus_allowed > 1)
+        enqueue_pushable_wrr_task(rq, p);
 }
 
 static void set_curr_task_wrr(struct rq *rq)
 {
-    printk("Set current wrr task!\n");
     struct task_struct *p = rq->curr;
 
     p->se.exec_start = rq->clock_task;
+    wrr_stats_wait_end(rq, p);
+
+    /* The running task is never eligible for pushing */
+    dequeue_pushable_wrr_task(rq, p);
 }
 
 static void task_tick_wrr(struct rq *rq, struct task_struct *p, int queued)
 {
-    printk("Time Slice left: [%d]\n",p->wrr.time_slice);
     struct sched_wrr_entity *wrr_se = &p->wrr;
 
+    trace_sched_wrr_tick(p, wrr_se_prio(wrr_se), task_wrr_class(p));
+
     update_curr_wrr(rq);
 
     if (p->policy != SCHED_WRR)
@@ -237,14 +553,11 @@ static void task_tick_wrr(struct rq *rq, struct task_struct *p, int queued)
     if (--p->wrr.time_slice)
         return;
 
-    if (task_group_path(p->sched_task_group)[1] != 'b') // Foreground
-    {
-        p->wrr.time_slice = WRR_FORE_TIMESLICE;
-    }
-    else // Background
-    {
-        p->wrr.time_slice = WRR_BACK_TIMESLICE;
-    }
+    schedstat_inc(p, wrr.statistics.nr_slice_expired);
+    schedstat_inc(rq, wrr.wrr_nr_slice_expired);
+
+    p->wrr.time_slice = task_wrr_timeslice(p);
+    wrr_se->boosted = 0;
 
     /*
      * Requeue to the end of queue if we (and all of our ancestors) are not the
@@ -260,60 +573,669 @@ static void task_tick_wrr(struct rq *rq, struct task_struct *p, int queued)
 
 static unsigned int get_rr_interval_wrr(struct rq *rq, struct task_struct *task)
 {
-    printk("Get wrr interval!");
     if (task == NULL)
         return -EINVAL;
 
-    if (task_group_path(task->sched_task_group)[1] != 'b')
-        return WRR_FORE_TIMESLICE;
-    else
-        return WRR_BACK_TIMESLICE;
+    return task_wrr_timeslice(task);
+}
+
+/*
+ * check_preempt_curr() preempts a task of a lower class outright and asks
+ * check_preempt_curr_wrr() when the current task is SCHED_WRR as well.
+ */
+static void switched_to_wrr(struct rq *rq, struct task_struct *p)
+{
+    if (p->on_rq && rq->curr != p)
+    {
+        check_preempt_curr(rq, p, 0);
+    }
 }
 
-static void task_fork_wrr(struct task_struct *p)
+#ifdef CONFIG_SMP
+static inline unsigned long wrr_cpu_load(int cpu)
 {
-    // printk("Fork a new wrr task!\n");
-    // p->wrr.time_slice = p->wrr.parent->time_slice;
+    return ACCESS_ONCE(cpu_rq(cpu)->wrr.wrr_weight);
 }
 
-static void switched_to_wrr(struct rq *rq, struct task_struct *p)
+/*
+ * An idle cpu other than @this_cpu that shares a cache with it, or -1.
+ */
+static int find_idle_sibling_wrr(struct task_struct *p, int this_cpu)
 {
-    printk("Switch to wrr task!\n");
-    // printk("%d\n", p->rt_priority);
-    if (p->on_rq && rq->curr != p)
+    int cpu;
+
+    for_each_cpu_and(cpu, tsk_cpus_allowed(p), cpu_active_mask)
     {
-        if (p->rt_priority < rq->curr->rt_priority)
-            resched_task(rq->curr);
+        if (cpu != this_cpu && idle_cpu(cpu) && cpus_share_cache(cpu, this_cpu))
+            return cpu;
     }
+
+    return -1;
 }
 
-void free_wrr_sched_group(struct task_group *tg){
+static int find_lowest_rq_wrr(struct task_struct *task);
+
+static int select_task_rq_wrr(struct task_struct *p, int sd_flag, int flags)
+{
+    int cpu = task_cpu(p);
+    int target;
+
+    if (p->rt.nr_cpus_allowed == 1)
+        return cpu;
+
+    /* For anything but wake ups, fork and exec, just return the task_cpu */
+    if (sd_flag != SD_BALANCE_WAKE && sd_flag != SD_BALANCE_FORK &&
+        sd_flag != SD_BALANCE_EXEC)
+        return cpu;
+
+    if (cpumask_test_cpu(cpu, tsk_cpus_allowed(p)) && idle_cpu(cpu))
+        return cpu;
+
+    /*
+     * A forked child starts right away on an idle cpu next to its parent,
+     * where what the parent just wrote is still cached, rather than
+     * waiting behind it.
+     */
+    if (sd_flag == SD_BALANCE_FORK)
+    {
+        target = find_idle_sibling_wrr(p, smp_processor_id());
+        if (target != -1)
+            return target;
+    }
+
+    /*
+     * The priority map hands out a cpu with no WRR work at all in
+     * O(MAX_WRR_PRIO). Only when every allowed cpu has some do we need
+     * to weigh them against each other.
+     */
+    target = find_lowest_rq_wrr(p);
+    if (target != -1 && !ACCESS_ONCE(cpu_rq(target)->wrr.wrr_nr_running))
+        return target;
+
+    target = wrr_find_lightest_cpu(p, cpu, wrr_cpu_load);
+    if (target != -1)
+        cpu = target;
 
+    return cpu;
 }
 
-int alloc_wrr_sched_group(struct task_group *tg, struct task_group *parent)
+/*
+ * Return the cpu with the most WRR weight in the innermost sched domain of
+ * @this_rq that has one sufficiently heavier than @this_rq, with a queued
+ * task to spare. Domains reaching beyond this NUMA node ask for
+ * WRR_NUMA_IMBALANCE_PCT instead of WRR_IMBALANCE_PCT, so that cache-hot
+ * tasks only leave their node when it is clearly overloaded.
+ */
+static struct rq *find_busiest_wrr_rq(struct rq *this_rq)
 {
-    return 1;
+    struct sched_domain *sd;
+    struct rq *busiest = NULL;
+    unsigned long load, max_load;
+    unsigned int pct;
+    int cpu, this_cpu = this_rq->cpu;
+
+    rcu_read_lock();
+    for_each_domain(this_cpu, sd)
+    {
+        if (!(sd->flags & SD_LOAD_BALANCE))
+            continue;
+
+        pct = sd_spans_nodes(sd, this_cpu) ? WRR_NUMA_IMBALANCE_PCT : WRR_IMBALANCE_PCT;
+        max_load = this_rq->wrr.wrr_weight;
+
+        for_each_cpu_and(cpu, sched_domain_span(sd), cpu_active_mask)
+        {
+            if (cpu == this_cpu || sd_child_has_cpu(sd, cpu))
+                continue;
+
+            load = wrr_cpu_load(cpu);
+            if (load > max_load && cpu_rq(cpu)->wrr.wrr_nr_running > 1)
+            {
+                max_load = load;
+                busiest = cpu_rq(cpu);
+            }
+        }
+
+        if (busiest && max_load * 100 >= this_rq->wrr.wrr_weight * pct)
+            break;
+        busiest = NULL;
+    }
+    rcu_read_unlock();
+
+    return busiest;
 }
 
-// Dummy functions
-static int select_task_rq_wrr(struct task_struct *p, int sd_flag, int flags) {}
+/*
+ * Move queued, not running, tasks from @busiest to @this_rq while that
+ * narrows the gap between the two. A task is only moved when its weight
+ * is at most half the gap, so the two runqueues never swap roles and the
+ * next balance pass cannot send the task straight back.
+ */
+static int move_wrr_tasks(struct rq *this_rq, struct rq *busiest)
+{
+    struct wrr_prio_array *array = &busiest->wrr.active;
+    struct sched_wrr_entity *wrr_se, *tmp;
+    struct task_struct *p;
+    unsigned long imbalance;
+    int idx, moved = 0;
+
+    for (idx = sched_find_first_bit(array->bitmap); idx < MAX_WRR_PRIO;
+         idx = find_next_bit(array->bitmap, MAX_WRR_PRIO, idx + 1))
+    {
+        list_for_each_entry_safe(wrr_se, tmp, wrr_prio_queue(array, idx), run_list)
+        {
+            if (moved >= sysctl_sched_nr_migrate)
+                return moved;
+
+            if (busiest->wrr.wrr_weight <= this_rq->wrr.wrr_weight)
+                return moved;
+            imbalance = busiest->wrr.wrr_weight - this_rq->wrr.wrr_weight;
+
+            p = wrr_task_of(wrr_se);
+            if (task_running(busiest, p) || p->rt.nr_cpus_allowed == 1 ||
+                !cpumask_test_cpu(this_rq->cpu, tsk_cpus_allowed(p)))
+                continue;
+            if (2 * wrr_se->weight > imbalance)
+                continue;
+
+            deactivate_task(busiest, p, 0);
+            set_task_cpu(p, this_rq->cpu);
+            wrr_stats_migrate(this_rq, p);
+            activate_task(this_rq, p, 0);
+            check_preempt_curr(this_rq, p, 0);
+            moved++;
+        }
+    }
+
+    return moved;
+}
+
+/*
+ * Called from scheduler_tick() with interrupts disabled. Every cpu pulls
+ * from the busiest cpu of its root domain, so weight flows from the
+ * heaviest runqueues to the lightest ones.
+ */
+void trigger_wrr_load_balance(struct rq *this_rq, int this_cpu)
+{
+    struct rq *busiest;
+
+    if (time_before(jiffies, this_rq->wrr.next_balance))
+        return;
+    this_rq->wrr.next_balance = jiffies + WRR_BALANCE_INTERVAL;
+
+    raw_spin_lock(&this_rq->lock);
+    if (!this_rq->online)
+        goto out;
+
+    busiest = find_busiest_wrr_rq(this_rq);
+    if (!busiest)
+        goto out;
+
+    double_lock_balance(this_rq, busiest);
+    move_wrr_tasks(this_rq, busiest);
+    double_unlock_balance(this_rq, busiest);
+out:
+    raw_spin_unlock(&this_rq->lock);
+}
+
+static DEFINE_PER_CPU(cpumask_var_t, wrr_local_cpu_mask);
+
+/*
+ * Find a cpu whose best queued WRR task ranks below @task, cpus with no
+ * WRR work ranking lowest. Cpus busy with RT tasks are skipped. Among the
+ * candidates we prefer the cpu @task last ran on, then the nearest ones
+ * in its domain tree up to its node, then this cpu if it is on that node.
+ * A candidate on another node is only taken when it carries less than
+ * 100 / WRR_NUMA_IMBALANCE_PCT of the weight of the cpu @task is on, as
+ * select_task_rq_wrr() and load balancing ask of a cross-node move.
+ */
+static int find_lowest_rq_wrr(struct task_struct *task)
+{
+    struct sched_domain *sd;
+    struct cpumask *lowest_mask = __get_cpu_var(wrr_local_cpu_mask);
+    int this_cpu = smp_processor_id();
+    int cpu = task_cpu(task);
+    int node = cpu_to_node(cpu);
+    unsigned long load, min_load = ULONG_MAX;
+    int i, best_cpu = -1;
+
+    /* Make sure the mask is initialized first */
+    if (unlikely(!lowest_mask))
+        return -1;
+
+    if (task->rt.nr_cpus_allowed == 1)
+        return -1; /* No other targets possible */
+
+    if (!wrrpri_find(&task_rq(task)->rd->wrrpri, task, wrr_task_prio(task), lowest_mask))
+        return -1; /* No targets found */
+
+    for_each_cpu(i, lowest_mask)
+    {
+        if (cpu_rq(i)->rt.rt_nr_running)
+            cpumask_clear_cpu(i, lowest_mask);
+    }
+
+    if (cpumask_test_cpu(cpu, lowest_mask))
+        return cpu;
+
+    if (!cpumask_test_cpu(this_cpu, lowest_mask))
+        this_cpu = -1; /* Skip this_cpu opt if not among lowest */
+
+    rcu_read_lock();
+    for_each_domain(cpu, sd)
+    {
+        if (sd_spans_nodes(sd, cpu))
+            break;
+
+        i = cpumask_first_and(lowest_mask, sched_domain_span(sd));
+        if (i < nr_cpu_ids)
+        {
+            rcu_read_unlock();
+            return i;
+        }
+    }
+    rcu_read_unlock();
+
+    if (this_cpu != -1 && cpu_to_node(this_cpu) == node)
+        return this_cpu;
+
+    /* Every candidate is on another node, take the lightest if it pays */
+    for_each_cpu(i, lowest_mask)
+    {
+        if (cpu_to_node(i) == node)
+            return i;
+
+        load = wrr_cpu_load(i);
+        if (load < min_load)
+        {
+            min_load = load;
+            best_cpu = i;
+        }
+    }
+
+    if (best_cpu != -1 &&
+        min_load * WRR_NUMA_IMBALANCE_PCT < wrr_cpu_load(cpu) * 100)
+        return best_cpu;
+    return -1;
+}
+
+/* Will lock the rq it finds */
+static struct rq *find_lock_lowest_rq_wrr(struct task_struct *task, struct rq *rq)
+{
+    struct rq *lowest_rq = NULL;
+    int tries;
+    int cpu;
+
+    for (tries = 0; tries < WRR_MAX_TRIES; tries++)
+    {
+        cpu = find_lowest_rq_wrr(task);
+
+        if ((cpu == -1) || (cpu == rq->cpu))
+            break;
+
+        lowest_rq = cpu_rq(cpu);
+
+        /* if the prio of this runqueue changed, try again */
+        if (double_lock_balance(rq, lowest_rq))
+        {
+            /*
+             * We had to unlock the run queue. In the mean time, task
+             * could have migrated already or had its affinity changed.
+             * Also make sure that it wasn't scheduled on its rq.
+             */
+            if (unlikely(task_rq(task) != rq ||
+                         !cpumask_test_cpu(lowest_rq->cpu, tsk_cpus_allowed(task)) ||
+                         task_running(rq, task) ||
+                         !task->on_rq))
+            {
+                raw_spin_unlock(&lowest_rq->lock);
+                lowest_rq = NULL;
+                break;
+            }
+        }
+
+        /* If this rq is still suitable use it. */
+        if (lowest_rq->wrr.highest_prio.curr > wrr_task_prio(task))
+            break;
+
+        /* try again */
+        double_unlock_balance(rq, lowest_rq);
+        lowest_rq = NULL;
+    }
+
+    return lowest_rq;
+}
+
+static struct task_struct *pick_next_pushable_wrr_task(struct rq *rq)
+{
+    struct task_struct *p;
+
+    if (!has_pushable_wrr_tasks(rq))
+        return NULL;
+
+    p = plist_first_entry(&rq->wrr.pushable_tasks,
+                          struct task_struct, wrr.pushable_tasks);
+
+    BUG_ON(rq->cpu != task_cpu(p));
+    BUG_ON(task_current(rq, p));
+    BUG_ON(p->rt.nr_cpus_allowed <= 1);
+    BUG_ON(!p->on_rq);
+
+    return p;
+}
+
+/*
+ * If the current CPU has more than one WRR task, see if the non running
+ * task can migrate over to a CPU whose WRR work ranks below it.
+ */
+static int push_wrr_task(struct rq *rq)
+{
+    struct task_struct *next_task;
+    struct rq *lowest_rq;
+    int ret = 0;
+
+    if (!rq->wrr.overloaded)
+        return 0;
+
+    next_task = pick_next_pushable_wrr_task(rq);
+    if (!next_task)
+        return 0;
+
+#ifdef __ARCH_WANT_INTERRUPTS_ON_CTXSW
+    if (unlikely(task_running(rq, next_task)))
+        return 0;
+#endif
+
+retry:
+    if (unlikely(next_task == rq->curr))
+    {
+        WARN_ON(1);
+        return 0;
+    }
+
+    /*
+     * It's possible that the next_task slipped in ahead of current. If
+     * that's the case just reschedule current.
+     */
+    if (unlikely(rq->curr->sched_class == &wrr_sched_class &&
+                 wrr_task_prio(next_task) < wrr_task_prio(rq->curr)))
+    {
+        resched_task(rq->curr);
+        return 0;
+    }
+
+    /* We might release rq lock */
+    get_task_struct(next_task);
+
+    /* find_lock_lowest_rq_wrr locks the rq if found */
+    lowest_rq = find_lock_lowest_rq_wrr(next_task, rq);
+    if (!lowest_rq)
+    {
+        struct task_struct *task;
+        /*
+         * find_lock_lowest_rq_wrr releases rq->lock so it is possible
+         * that next_task has migrated. Make sure it is still on this
+         * runqueue and still the next task eligible for pushing.
+         */
+        task = pick_next_pushable_wrr_task(rq);
+        if (task_cpu(next_task) == rq->cpu && task == next_task)
+        {
+            /*
+             * No runqueue to push it to. Do not retry in this case,
+             * other cpus will pull from us when ready.
+             */
+            goto out;
+        }
+
+        if (!task)
+            /* No more tasks, just exit */
+            goto out;
+
+        /* Something has shifted, try again. */
+        put_task_struct(next_task);
+        next_task = task;
+        goto retry;
+    }
 
-static void set_cpus_allowed_wrr(struct task_struct *p, const struct cpumask *new_mask) {}
+    deactivate_task(rq, next_task, 0);
+    set_task_cpu(next_task, lowest_rq->cpu);
+    wrr_stats_migrate(lowest_rq, next_task);
+    activate_task(lowest_rq, next_task, 0);
+    ret = 1;
 
-static void rq_offline_wrr(struct rq *rq) {}
+    resched_task(lowest_rq->curr);
 
-static void rq_online_wrr(struct rq *rq) {}
+    double_unlock_balance(rq, lowest_rq);
 
-static void pre_schedule_wrr(struct rq *rq, struct task_struct *prev) {}
+out:
+    put_task_struct(next_task);
 
-static void post_schedule_wrr(struct rq *rq) {}
+    return ret;
+}
+
+static void push_wrr_tasks(struct rq *rq)
+{
+    /* push_wrr_task will return true if it moved a WRR task */
+    while (push_wrr_task(rq))
+        ;
+}
+
+/* Return the best queued WRR task of @rq that may run on @cpu */
+static struct task_struct *pick_highest_pushable_wrr_task(struct rq *rq, int cpu)
+{
+    struct task_struct *p;
+
+    plist_for_each_entry(p, &rq->wrr.pushable_tasks, wrr.pushable_tasks)
+    {
+        if (!task_running(rq, p) && cpumask_test_cpu(cpu, tsk_cpus_allowed(p)))
+            return p;
+    }
+
+    return NULL;
+}
 
-static void task_woken_wrr(struct rq *rq, struct task_struct *p) {}
+static int pull_wrr_task(struct rq *this_rq)
+{
+    int this_cpu = this_rq->cpu, ret = 0, cpu;
+    struct task_struct *p;
+    struct rq *src_rq;
+
+    if (likely(!wrr_overloaded(this_rq)))
+        return 0;
+
+    for_each_cpu(cpu, this_rq->rd->wrro_mask)
+    {
+        if (this_cpu == cpu)
+            continue;
+
+        src_rq = cpu_rq(cpu);
+
+        /*
+         * Don't bother taking the src_rq->lock if the next best task
+         * is known to rank no higher than our own queued work. This
+         * may look racy, but if the value is about to go logically
+         * higher, src_rq will push the task away itself.
+         */
+        if (src_rq->wrr.highest_prio.next >= this_rq->wrr.highest_prio.curr)
+            continue;
+
+        /*
+         * We can potentially drop this_rq's lock in double_lock_balance,
+         * and another CPU could alter this_rq
+         */
+        double_lock_balance(this_rq, src_rq);
+
+        /* Are there still pullable WRR tasks? */
+        if (src_rq->wrr.wrr_nr_running <= 1)
+            goto skip;
+
+        p = pick_highest_pushable_wrr_task(src_rq, this_cpu);
+
+        /* Do we have a WRR task that ranks above our own queued work? */
+        if (p && wrr_task_prio(p) < this_rq->wrr.highest_prio.curr)
+        {
+            WARN_ON(p == src_rq->curr);
+            WARN_ON(!p->on_rq);
+
+            /*
+             * p may be about to preempt the current task of its cpu,
+             * in which case it will run there soon enough.
+             */
+            if (src_rq->curr->sched_class == &wrr_sched_class &&
+                wrr_task_prio(p) < wrr_task_prio(src_rq->curr))
+                goto skip;
+
+            ret = 1;
+
+            deactivate_task(src_rq, p, 0);
+            set_task_cpu(p, this_cpu);
+            wrr_stats_migrate(this_rq, p);
+            activate_task(this_rq, p, 0);
+            /*
+             * We continue with the search, just in case there's an
+             * even better task in another runqueue.
+             */
+        }
+skip:
+        double_unlock_balance(this_rq, src_rq);
+    }
 
+    return ret;
+}
+
+/*
+ * Called from __schedule() when this cpu is about to go idle, whatever
+ * class its previous task belonged to.
+ */
+void idle_pull_wrr_task(struct rq *this_rq)
+{
+    pull_wrr_task(this_rq);
+}
+
+static void pre_schedule_wrr(struct rq *rq, struct task_struct *prev)
+{
+    /* Try to pull WRR tasks here if we lower this rq's prio */
+    if (rq->wrr.highest_prio.curr > wrr_task_prio(prev))
+        pull_wrr_task(rq);
+}
+
+static void post_schedule_wrr(struct rq *rq)
+{
+    push_wrr_tasks(rq);
+}
+
+/*
+ * If we are not running and we are not going to reschedule soon, we should
+ * try to push tasks away now
+ */
+static void task_woken_wrr(struct rq *rq, struct task_struct *p)
+{
+    if (!task_running(rq, p) &&
+        !test_tsk_need_resched(rq->curr) &&
+        has_pushable_wrr_tasks(rq) &&
+        p->rt.nr_cpus_allowed > 1 &&
+        rq->curr->sched_class == &wrr_sched_class &&
+        (rq->curr->rt.nr_cpus_allowed < 2 ||
+         wrr_task_prio(rq->curr) <= wrr_task_prio(p)))
+        push_wrr_tasks(rq);
+}
+
+static void set_cpus_allowed_wrr(struct task_struct *p, const struct cpumask *new_mask)
+{
+    struct rq *rq;
+    int weight;
+
+    if (!p->on_rq)
+        return;
+
+    weight = cpumask_weight(new_mask);
+
+    /* Only update if the process changes its state from whether it can migrate or not. */
+    if ((p->rt.nr_cpus_allowed > 1) == (weight > 1))
+        return;
+
+    rq = task_rq(p);
+
+    /* The process used to be able to migrate OR it can now migrate */
+    if (weight <= 1)
+    {
+        if (!task_current(rq, p))
+            dequeue_pushable_wrr_task(rq, p);
+        BUG_ON(!rq->wrr.wrr_nr_migratory);
+        rq->wrr.wrr_nr_migratory--;
+    }
+    else
+    {
+        if (!task_current(rq, p))
+            enqueue_pushable_wrr_task(rq, p);
+        rq->wrr.wrr_nr_migratory++;
+    }
+
+    update_wrr_migration(&rq->wrr);
+}
+
+/* Assumes rq->lock is held */
+static void rq_online_wrr(struct rq *rq)
+{
+    if (rq->wrr.overloaded)
+        wrr_set_overload(rq);
+
+    enable_wrr_runtime(rq);
+
+    wrrpri_set(&rq->rd->wrrpri, rq->cpu, rq->wrr.highest_prio.curr);
+}
+
+/* Assumes rq->lock is held */
+static void rq_offline_wrr(struct rq *rq)
+{
+    if (rq->wrr.overloaded)
+        wrr_clear_overload(rq);
+
+    disable_wrr_runtime(rq);
+
+    wrrpri_set(&rq->rd->wrrpri, rq->cpu, WRRPRI_INVALID);
+}
+
+/*
+ * When switch from the wrr queue, we bring ourselves to a position that
+ * we might want to pull WRR tasks from other runqueues.
+ */
+static void switched_from_wrr(struct rq *rq, struct task_struct *p)
+{
+    if (p->on_rq && !rq->wrr.wrr_nr_running)
+        pull_wrr_task(rq);
+}
+#else
 static void switched_from_wrr(struct rq *rq, struct task_struct *p) {}
+#endif /* CONFIG_SMP */
+
+void free_wrr_sched_group(struct task_group *tg){
+
+}
 
-static void prio_changed_wrr(struct rq *rq, struct task_struct *p, int oldprio) {}
+int alloc_wrr_sched_group(struct task_group *tg, struct task_group *parent)
+{
+    return 1;
+}
+
+// Dummy functions
+/*
+ * __sched_setscheduler() has requeued @p on its new level: give up the cpu
+ * if @p runs and an earlier level is queued now, else see if @p preempts.
+ */
+static void prio_changed_wrr(struct rq *rq, struct task_struct *p, int oldprio)
+{
+    if (!p->on_rq)
+        return;
+
+    if (rq->curr == p)
+    {
+        if (wrr_level_before(rq->wrr.highest_prio.curr, wrr_task_prio(p)))
+            resched_task(p);
+    }
+    else
+        check_preempt_curr(rq, p, 0);
+}
 
 const struct sched_class wrr_sched_class = {
     .next = &fair_sched_class,                    /*Required*/
@@ -325,23 +1247,36 @@ const struct sched_class wrr_sched_class = {
     .pick_next_task = pick_next_task_wrr, /*Required*/
     .put_prev_task = put_prev_task_wrr,   /*Required*/
 
-    .task_fork = task_fork_wrr,
+    .task_fork = wrr_task_fork,
 #ifdef CONFIG_SMP
-    .select_task_rq = select_task_rq_wrr, /*Never need impl*/
+    .select_task_rq = select_task_rq_wrr,
     .set_cpus_allowed = set_cpus_allowed_wrr,
-    .rq_online = rq_online_wrr,         /*Never need impl*/
-    .rq_offline = rq_offline_wrr,       /*Never need impl*/
-    .pre_schedule = pre_schedule_wrr,   /*Never need impl*/
-    .post_schedule = post_schedule_wrr, /*Never need impl*/
-    .task_woken = task_woken_wrr,       /*Never need impl*/
+    .rq_online = rq_online_wrr,
+    .rq_offline = rq_offline_wrr,
+    .pre_schedule = pre_schedule_wrr,
+    .post_schedule = post_schedule_wrr,
+    .task_woken = task_woken_wrr,
 #endif
-    .switched_from = switched_from_wrr, /*Never need impl*/
+    .switched_from = switched_from_wrr,
 
     .set_curr_task = set_curr_task_wrr, /*Required*/
     .task_tick = task_tick_wrr,         /*Required*/
 
     .get_rr_interval = get_rr_interval_wrr,
 
-    .prio_changed = prio_changed_wrr, /*Never need impl*/
-    .switched_to = switched_to_wrr,   /*Never need impl*/
+    .prio_changed = prio_changed_wrr,
+    .switched_to = switched_to_wrr,
 };
+
+__init void init_sched_wrr_class(void)
+{
+#ifdef CONFIG_SMP
+    unsigned int i;
+
+    for_each_possible_cpu(i)
+    {
+        zalloc_cpumask_var_node(&per_cpu(wrr_local_cpu_mask, i),
+                                GFP_NOWAIT, cpu_to_node(i));
+    }
+#endif
+}
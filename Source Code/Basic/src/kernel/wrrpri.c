@@ -0,0 +1,203 @@
+/*
+ *  kernel/sched/wrrpri.c
+ *
+ *  WRR priority to CPU map, modeled on cpupri.c
+ *
+ *  Every cpu of a root domain is filed under the WRR queue index of the
+ *  best task queued on its wrr_rq, or under WRRPRI_IDLE when it has no
+ *  WRR work at all. Looking for a cpu whose WRR work ranks below a given
+ *  task then only walks the (at most MAX_WRR_PRIO) vectors below the
+ *  task's level instead of every runqueue, so the cost stays flat as the
+ *  number of cpus grows.
+ *
+ *  As with cpupri, the lower a queue index the sooner it is picked, and
+ *  a vector is only ever read locklessly: a stale answer is corrected by
+ *  the push/pull logic that rechecks under the runqueue locks.
+ */
+
+#include <linux/gfp.h>
+#include "wrrpri.h"
+
+/* Convert between a WRR queue index and a wrrpri level */
+static int convert_prio(int prio)
+{
+	int wrrpri;
+
+	if (prio == WRRPRI_INVALID)
+		wrrpri = WRRPRI_INVALID;
+	else if (prio >= MAX_WRR_PRIO)
+		wrrpri = WRRPRI_IDLE;
+	else
+		wrrpri = MAX_WRR_PRIO - prio;
+
+	return wrrpri;
+}
+
+/**
+ * wrrpri_find - find the best (lowest-pri) CPU in the system
+ * @cp: The wrrpri context
+ * @p: The task
+ * @prio: The WRR queue index @p would be queued at
+ * @lowest_mask: A mask to fill in with selected CPUs (or NULL)
+ *
+ * Note: This function returns the recommended CPUs as calculated during the
+ * current invocation.  By the time the call returns, the CPUs may have in
+ * fact changed priorities any number of times.  While not ideal, it is not
+ * an issue of correctness since the normal rebalancer logic will correct
+ * any discrepancies created by racing against the uncertainty of the current
+ * priority configuration.
+ *
+ * Returns: (int)bool - CPUs were found
+ */
+int wrrpri_find(struct wrrpri *cp, struct task_struct *p, int prio,
+		struct cpumask *lowest_mask)
+{
+	int idx = 0;
+	int task_pri = convert_prio(prio);
+
+	for (idx = 0; idx < task_pri; idx++) {
+		struct wrrpri_vec *vec  = &cp->pri_to_cpu[idx];
+		int skip = 0;
+
+		if (!atomic_read(&(vec)->count))
+			skip = 1;
+		/*
+		 * When looking at the vector, we need to read the counter,
+		 * do a memory barrier, then read the mask. This pairs with
+		 * the barriers in wrrpri_set().
+		 */
+		smp_rmb();
+
+		/* Need to do the rmb for every iteration */
+		if (skip)
+			continue;
+
+		if (cpumask_any_and(tsk_cpus_allowed(p), vec->mask) >= nr_cpu_ids)
+			continue;
+
+		if (lowest_mask) {
+			cpumask_and(lowest_mask, tsk_cpus_allowed(p), vec->mask);
+
+			/*
+			 * The map could have been concurrently emptied between
+			 * the first and second reads of vec->mask. If so, act
+			 * as though we never hit this priority level.
+			 */
+			if (cpumask_any(lowest_mask) >= nr_cpu_ids)
+				continue;
+		}
+
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * wrrpri_set - update the cpu priority setting
+ * @cp: The wrrpri context
+ * @cpu: The target cpu
+ * @newpri: The WRR queue index of the best queued task, MAX_WRR_PRIO if
+ *          there is none, or WRRPRI_INVALID when the cpu goes offline
+ *
+ * Note: Assumes cpu_rq(cpu)->lock is locked
+ *
+ * Returns: (void)
+ */
+void wrrpri_set(struct wrrpri *cp, int cpu, int newpri)
+{
+	int *currpri = &cp->cpu_to_pri[cpu];
+	int oldpri = *currpri;
+	int do_mb = 0;
+
+	newpri = convert_prio(newpri);
+
+	BUG_ON(newpri >= WRRPRI_NR_PRIORITIES);
+
+	if (newpri == oldpri)
+		return;
+
+	/*
+	 * If the cpu was currently mapped to a different value, we
+	 * need to map it to the new value then remove the old value.
+	 * Note, we must add the new value first, otherwise we risk the
+	 * cpu being missed by the priority loop in wrrpri_find.
+	 */
+	if (likely(newpri != WRRPRI_INVALID)) {
+		struct wrrpri_vec *vec = &cp->pri_to_cpu[newpri];
+
+		cpumask_set_cpu(cpu, vec->mask);
+		/*
+		 * When adding a new vector, we update the mask first,
+		 * do a write memory barrier, and then update the count, to
+		 * make sure the vector is visible when count is set.
+		 */
+		smp_mb__before_atomic_inc();
+		atomic_inc(&(vec)->count);
+		do_mb = 1;
+	}
+	if (likely(oldpri != WRRPRI_INVALID)) {
+		struct wrrpri_vec *vec  = &cp->pri_to_cpu[oldpri];
+
+		/*
+		 * Because the order of modification of the vec->count
+		 * is important, we must make sure that the update
+		 * of the new prio is seen before we decrement the
+		 * old prio.
+		 */
+		if (do_mb)
+			smp_mb__after_atomic_inc();
+
+		/*
+		 * When removing from the vector, we decrement the counter first
+		 * do a memory barrier and then clear the mask.
+		 */
+		atomic_dec(&(vec)->count);
+		smp_mb__after_atomic_inc();
+		cpumask_clear_cpu(cpu, vec->mask);
+	}
+
+	*currpri = newpri;
+}
+
+/**
+ * wrrpri_init - initialize the wrrpri structure
+ * @cp: The wrrpri context
+ *
+ * Returns: -ENOMEM if memory fails.
+ */
+int wrrpri_init(struct wrrpri *cp)
+{
+	int i;
+
+	memset(cp, 0, sizeof(*cp));
+
+	for (i = 0; i < WRRPRI_NR_PRIORITIES; i++) {
+		struct wrrpri_vec *vec = &cp->pri_to_cpu[i];
+
+		atomic_set(&vec->count, 0);
+		if (!zalloc_cpumask_var(&vec->mask, GFP_KERNEL))
+			goto cleanup;
+	}
+
+	for_each_possible_cpu(i)
+		cp->cpu_to_pri[i] = WRRPRI_INVALID;
+	return 0;
+
+cleanup:
+	for (i--; i >= 0; i--)
+		free_cpumask_var(cp->pri_to_cpu[i].mask);
+	return -ENOMEM;
+}
+
+/**
+ * wrrpri_cleanup - clean up the wrrpri structure
+ * @cp: The wrrpri context
+ */
+void wrrpri_cleanup(struct wrrpri *cp)
+{
+	int i;
+
+	for (i = 0; i < WRRPRI_NR_PRIORITIES; i++)
+		free_cpumask_var(cp->pri_to_cpu[i].mask);
+}
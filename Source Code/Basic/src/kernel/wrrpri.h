@@ -0,0 +1,33 @@
+#ifndef _LINUX_WRRPRI_H
+#define _LINUX_WRRPRI_H
+
+#include <linux/sched.h>
+
+#define WRRPRI_NR_PRIORITIES	(MAX_WRR_PRIO + 1)
+
+#define WRRPRI_INVALID -1
+#define WRRPRI_IDLE     0
+/* values 1-100 are WRR queue indexes 99-0 */
+
+struct wrrpri_vec {
+	atomic_t	count;
+	cpumask_var_t	mask;
+};
+
+struct wrrpri {
+	struct wrrpri_vec pri_to_cpu[WRRPRI_NR_PRIORITIES];
+	int               cpu_to_pri[NR_CPUS];
+};
+
+#ifdef CONFIG_SMP
+int  wrrpri_find(struct wrrpri *cp, struct task_struct *p, int prio,
+		 struct cpumask *lowest_mask);
+void wrrpri_set(struct wrrpri *cp, int cpu, int prio);
+int wrrpri_init(struct wrrpri *cp);
+void wrrpri_cleanup(struct wrrpri *cp);
+#else
+#define wrrpri_set(cp, cpu, prio) do { } while (0)
+#define wrrpri_init() do { } while (0)
+#endif
+
+#endif /* _LINUX_WRRPRI_H */
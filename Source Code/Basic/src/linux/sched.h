@@ -1249,18 +1249,57 @@ struct sched_rt_entity {
 #endif
 };
 
+#ifdef CONFIG_SCHEDSTATS
+struct sched_wrr_statistics {
+        u64                        wait_start;        /* queued but not running since */
+        u64                        wait_max;
+        u64                        wait_count;
+        u64                        wait_sum;          /* run delay on the wrr_prio_array */
+
+        u64                        nr_slice_expired;
+        u64                        nr_voluntary_switches;
+        u64                        nr_involuntary_switches;
+        u64                        nr_prio_changes;   /* RMLFQ stage moves */
+        u64                        nr_wakeup_boosts;  /* woken to the head of a level */
+        u64                        nr_migrations;
+};
+#endif
+
+/*
+ * run_list, time_slice and weight are all that enqueue, pick_next and
+ * task_tick touch, so they come first and sit next to each other.
+ */
 struct sched_wrr_entity {
         struct list_head run_list;
-        unsigned long timeout;
         unsigned int time_slice;
-        // unsigned int times = 0; 
+        unsigned int weight;        /* contribution to wrr_rq->wrr_weight */
+        int prio;                /* queue level if the class caches it */
+#ifdef CONFIG_SMP
+        struct plist_node pushable_tasks;
+#endif
 
-        struct sched_wrr_entity *back;
 // #ifdef CONFIG_WRR_GROUP_SCHED
+        struct sched_wrr_entity *back;
         struct sched_wrr_entity *parent;
         struct wrr_rq    *wrr_rq;
         struct wrr_rq    *my_q;
 // #endif
+
+        /*
+         * Wakeup feedback: runtime mark at the last decision, sleep since
+         * then (RMLFQ), start of the current sleep, and the decayed run
+         * and sleep time between wakeups (basic WRR).
+         */
+        u64 fb_exec_start;
+        u64 fb_sleep;
+        u64 fb_sleep_start;
+        u64 avg_run;
+        u64 avg_sleep;
+        int boosted;                /* woken to the head of its level */
+
+#ifdef CONFIG_SCHEDSTATS
+        struct sched_wrr_statistics statistics;
+#endif
 };
 
 /*
@@ -1269,8 +1308,29 @@ struct sched_wrr_entity {
  */
 #define RR_TIMESLICE                (100 * HZ / 1000)
 
-#define WRR_FORE_TIMESLICE        (100 * HZ / 1000)
-#define WRR_BACK_TIMESLICE        (10 * HZ / 1000)
+/*
+ * Default SCHED_WRR timeslices in usecs, tunable at runtime through the
+ * kernel.sched_wrr_fore_timeslice_us and sched_wrr_back_timeslice_us
+ * sysctls.
+ */
+#define WRR_FORE_TIMESLICE_US        100000
+#define WRR_BACK_TIMESLICE_US        10000
+
+/*
+ * A waking SCHED_WRR task does not preempt one with at most this many
+ * usecs of its slice left, kernel.sched_wrr_wakeup_granularity_us. Kept
+ * well below WRR_BACK_TIMESLICE_US, or background tasks could never be
+ * preempted by a wakeup.
+ */
+#define WRR_WAKEUP_GRANULARITY_US        2000
+
+/*
+ * cpu.wrr_weight of a task group scales the slice of its tier, the
+ * default weight giving exactly the sysctl value.
+ */
+#define WRR_DEFAULT_WEIGHT        100
+#define WRR_MIN_WEIGHT                1
+#define WRR_MAX_WEIGHT                10000
 
 struct rcu_node;
 
@@ -2118,6 +2178,14 @@ int sched_rt_handler(struct ctl_table *table, int write,
                 void __user *buffer, size_t *lenp,
                 loff_t *ppos);
 
+extern unsigned int sysctl_sched_wrr_fore_timeslice_us;
+extern unsigned int sysctl_sched_wrr_back_timeslice_us;
+extern unsigned int sysctl_sched_wrr_wakeup_granularity_us;
+
+int sched_wrr_timeslice_handler(struct ctl_table *table, int write,
+                void __user *buffer, size_t *lenp,
+                loff_t *ppos);
+
 #ifdef CONFIG_SCHED_AUTOGROUP
 extern unsigned int sysctl_sched_autogroup_enabled;
 
@@ -0,0 +1,142 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM sched_wrr
+
+#if !defined(_TRACE_SCHED_WRR_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SCHED_WRR_H
+
+#include <linux/sched.h>
+#include <linux/tracepoint.h>
+
+#define show_wrr_class(class)					\
+	__print_symbolic(class,					\
+		{ 0, "other" },					\
+		{ 1, "fore" },					\
+		{ 2, "back" })
+
+/*
+ * Tracepoint for the WRR runqueue operations on a single task. @prio is
+ * the queue index the task is (or was) queued at and @wrr_class its
+ * foreground/background group class.
+ */
+DECLARE_EVENT_CLASS(sched_wrr_task_template,
+
+	TP_PROTO(struct task_struct *p, int prio, int wrr_class),
+
+	TP_ARGS(p, prio, wrr_class),
+
+	TP_STRUCT__entry(
+		__array(	char,	comm,	TASK_COMM_LEN	)
+		__field(	pid_t,	pid			)
+		__field(	int,	prio			)
+		__field(	unsigned int,	time_slice	)
+		__field(	int,	wrr_class		)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->comm, p->comm, TASK_COMM_LEN);
+		__entry->pid		= p->pid;
+		__entry->prio		= prio;
+		__entry->time_slice	= p->wrr.time_slice;
+		__entry->wrr_class	= wrr_class;
+	),
+
+	TP_printk("comm=%s pid=%d prio=%d slice=%u class=%s",
+		  __entry->comm, __entry->pid, __entry->prio,
+		  __entry->time_slice, show_wrr_class(__entry->wrr_class))
+);
+
+/*
+ * Tracepoint for a task being queued on a WRR runqueue:
+ */
+DEFINE_EVENT(sched_wrr_task_template, sched_wrr_enqueue,
+	     TP_PROTO(struct task_struct *p, int prio, int wrr_class),
+	     TP_ARGS(p, prio, wrr_class));
+
+/*
+ * Tracepoint for a task leaving a WRR runqueue:
+ */
+DEFINE_EVENT(sched_wrr_task_template, sched_wrr_dequeue,
+	     TP_PROTO(struct task_struct *p, int prio, int wrr_class),
+	     TP_ARGS(p, prio, wrr_class));
+
+/*
+ * Tracepoint for a task moved to the tail of its queue, either because
+ * its slice expired or because it yielded:
+ */
+DEFINE_EVENT(sched_wrr_task_template, sched_wrr_requeue,
+	     TP_PROTO(struct task_struct *p, int prio, int wrr_class),
+	     TP_ARGS(p, prio, wrr_class));
+
+/*
+ * Tracepoint for the scheduler tick of a running WRR task, before the
+ * tick is charged to its slice:
+ */
+DEFINE_EVENT(sched_wrr_task_template, sched_wrr_tick,
+	     TP_PROTO(struct task_struct *p, int prio, int wrr_class),
+	     TP_ARGS(p, prio, wrr_class));
+
+/*
+ * Tracepoint for a WRR task giving up the cpu:
+ */
+DEFINE_EVENT(sched_wrr_task_template, sched_wrr_put_prev,
+	     TP_PROTO(struct task_struct *p, int prio, int wrr_class),
+	     TP_ARGS(p, prio, wrr_class));
+
+/*
+ * Tracepoint for a task moved to another WRR queue index:
+ */
+TRACE_EVENT(sched_wrr_prio_change,
+
+	TP_PROTO(struct task_struct *p, int oldprio, int newprio),
+
+	TP_ARGS(p, oldprio, newprio),
+
+	TP_STRUCT__entry(
+		__array(	char,	comm,	TASK_COMM_LEN	)
+		__field(	pid_t,	pid			)
+		__field(	int,	oldprio			)
+		__field(	int,	newprio			)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->comm, p->comm, TASK_COMM_LEN);
+		__entry->pid		= p->pid;
+		__entry->oldprio	= oldprio;
+		__entry->newprio	= newprio;
+	),
+
+	TP_printk("comm=%s pid=%d oldprio=%d newprio=%d",
+		  __entry->comm, __entry->pid,
+		  __entry->oldprio, __entry->newprio)
+);
+
+/*
+ * Tracepoint for a woken or newly queued task being checked against the
+ * running task of its cpu:
+ */
+TRACE_EVENT(sched_wrr_check_preempt,
+
+	TP_PROTO(struct task_struct *curr, struct task_struct *p, int preempt),
+
+	TP_ARGS(curr, p, preempt),
+
+	TP_STRUCT__entry(
+		__field(	pid_t,	curr_pid		)
+		__field(	pid_t,	pid			)
+		__field(	int,	preempt			)
+	),
+
+	TP_fast_assign(
+		__entry->curr_pid	= curr->pid;
+		__entry->pid		= p->pid;
+		__entry->preempt	= preempt;
+	),
+
+	TP_printk("curr_pid=%d pid=%d preempt=%d",
+		  __entry->curr_pid, __entry->pid, __entry->preempt)
+);
+
+#endif /* _TRACE_SCHED_WRR_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -5,31 +5,65 @@
 #include "sched.h"
 #include <linux/slab.h>
 #include <linux/random.h>
+#include <linux/sysctl.h>
 
-#define UNSIGNED_MAX 4294967295
+#define CREATE_TRACE_POINTS
+#include <trace/events/sched_wrr.h>
 
-static unsigned int getRand() {
-    unsigned int randNum;
-    get_random_bytes(&randNum,sizeof(unsigned int));
-    return randNum;
-}
+/*
+ * Stages are groups of 10 queue levels. How likely a task is to leave its
+ * stage on requeue depends on the stage and on how many times in a row it
+ * stayed there; past WRR_RMLFQ_MAX_TIMES it always moves up a stage.
+ */
+#define WRR_RMLFQ_STAGES    10
+#define WRR_RMLFQ_MAX_TIMES 11
 
-// To determine whether the process is in foreground or background
-static char group_path[10000];
-static char *task_group_path(struct task_group *tg)
-{
-    if (autogroup_path(tg, group_path, 10000))
-        return group_path;
+/*
+ * A random u32 r moves the task up a stage, towards the top one, if
+ * r < up and otherwise down a stage, towards longer slices, if r > down.
+ * Up and down mean the same as promote and demote in feedback mode.
+ * Filled in by init_sched_wrr_class().
+ */
+struct wrr_rmlfq_odds {
+    u64 up;
+    s64 down;
+};
 
-    if (!tg->css.cgroup)
-    {
-        group_path[0] = '\0';
-        return group_path;
-    }
-    cgroup_path(tg->css.cgroup, group_path, 10000);
-    return group_path;
+static struct wrr_rmlfq_odds
+wrr_rmlfq_odds[WRR_RMLFQ_STAGES][WRR_RMLFQ_MAX_TIMES + 1] __read_mostly;
+
+/*
+ * Requeue runs under the rq lock on every slice expiry and yield, so each
+ * cpu draws from its own cheap generator rather than the entropy pool.
+ */
+static DEFINE_PER_CPU(struct rnd_state, wrr_rnd_state);
+
+static inline u32 wrr_rand(struct rq *rq)
+{
+    return prandom32(&per_cpu(wrr_rnd_state, cpu_of(rq)));
 }
 
+/*
+ * Feedback tunables, under /proc/sys/kernel/sched_wrr_rmlfq_*:
+ *
+ * slice_ms     foreground slice of each stage at the default weight
+ * demote_pct   a task that ran at least this share of its time since
+ *              the last decision moves one stage down (longer slices)
+ * promote_pct  a task that ran at most this share moves one stage up
+ * boost_ms     every so often all tasks go back to the top stage so
+ *              that the lower stages cannot starve; 0 disables it
+ * random       use the randomized stage walk instead of the above
+ */
+static unsigned int sysctl_sched_wrr_rmlfq_slice_ms[WRR_RMLFQ_STAGES] __read_mostly = {
+    100, 200, 300, 400, 500, 600, 700, 800, 900, 1000,
+};
+static unsigned int sysctl_sched_wrr_rmlfq_demote_pct __read_mostly = 80;
+static unsigned int sysctl_sched_wrr_rmlfq_promote_pct __read_mostly = 20;
+static unsigned int sysctl_sched_wrr_rmlfq_boost_ms __read_mostly = 1000;
+static unsigned int sysctl_sched_wrr_rmlfq_random __read_mostly;
+
+static DEFINE_PER_CPU(unsigned long, wrr_next_boost);
+
 static inline struct task_struct *wrr_task_of(struct sched_wrr_entity *wrr_se)
 {
     return container_of(wrr_se, struct task_struct, wrr);
@@ -48,14 +82,42 @@ static inline struct wrr_rq *wrr_rq_of_se(struct sched_wrr_entity *wrr_se)
     return &rq->wrr;
 }
 
+/*
+ * The queue level of a task is kept in wrr_se->prio, so rt_priority stays
+ * what the user set. wrr_prio_level() of rt_priority is where a task
+ * starts out, and __setscheduler() asks for that by setting MAX_WRR_PRIO.
+ */
 static inline int wrr_se_prio(struct sched_wrr_entity *wrr_se)
 {
-    return 99 - wrr_task_of(wrr_se)->rt_priority;
+    return wrr_se->prio;
 }
 
 static inline int wrr_task_prio(struct task_struct *p)
 {
-    return 99 - p->rt_priority;
+    if (unlikely(p->wrr.prio >= MAX_WRR_PRIO))
+        p->wrr.prio = wrr_prio_level(p->rt_priority);
+
+    return p->wrr.prio;
+}
+
+static inline int wrr_task_stage(struct task_struct *p)
+{
+    return wrr_task_prio(p) / 10;
+}
+
+/* Slice in jiffies of @p in its current stage */
+static unsigned int wrr_stage_timeslice(struct task_struct *p)
+{
+    u64 slice_us;
+
+    // Background tasks get the same slice in every stage
+    if (task_wrr_class(p) == WRR_GROUP_BACK)
+        return task_wrr_timeslice(p);
+
+    slice_us = (u64)sysctl_sched_wrr_rmlfq_slice_ms[wrr_task_stage(p)] * USEC_PER_MSEC;
+    slice_us = div_u64(slice_us * task_wrr_weight(p), WRR_DEFAULT_WEIGHT);
+
+    return max_t(unsigned int, usecs_to_jiffies(slice_us), 1);
 }
 
 /*
@@ -64,7 +126,6 @@ static inline int wrr_task_prio(struct task_struct *p)
  */
 static void update_curr_wrr(struct rq *rq)
 {
-    // printk("Update current task statistics!\n");
     struct task_struct *curr = rq->curr;
     u64 delta_exec;
 
@@ -83,6 +144,23 @@ static void update_curr_wrr(struct rq *rq)
 
     curr->se.exec_start = rq->clock_task;
     cpuacct_charge(curr, delta_exec);
+
+    if (sched_wrr_charge_runtime(&rq->wrr, delta_exec))
+        resched_task(curr);
+}
+
+/*
+ * Only the root wrr_rq is charged, and pick_next_task_wrr() leaves it
+ * alone while it is throttled, so there is nothing to take off the cpu.
+ */
+void sched_wrr_rq_dequeue(struct wrr_rq *wrr_rq)
+{
+}
+
+void sched_wrr_rq_enqueue(struct wrr_rq *wrr_rq)
+{
+    if (wrr_rq->wrr_nr_running)
+        resched_task(rq_of_wrr_rq(wrr_rq)->curr);
 }
 
 static inline void list_del_leaf_wrr_rq(struct wrr_rq *wrr_rq)
@@ -96,7 +174,7 @@ static void dequeue_wrr_entity(struct sched_wrr_entity *wrr_se)
     struct wrr_prio_array *array = &wrr_rq->active;
 
     list_del_init(&wrr_se->run_list);
-    if (list_empty(array->queue + wrr_se_prio(wrr_se)))
+    if (list_empty(wrr_prio_queue(array, wrr_se_prio(wrr_se))))
         __clear_bit(wrr_se_prio(wrr_se), array->bitmap);
 
     WARN_ON(!wrr_rq->wrr_nr_running);
@@ -108,13 +186,18 @@ static void dequeue_wrr_entity(struct sched_wrr_entity *wrr_se)
 
 static void dequeue_task_wrr(struct rq *rq, struct task_struct *p, int flags)
 {
-    printk("Dequeue a wrr task!\n");
-
     struct sched_wrr_entity *wrr_se = &p->wrr;
 
+    trace_sched_wrr_dequeue(p, wrr_se_prio(wrr_se), task_wrr_class(p));
+
     update_curr_wrr(rq);
+    wrr_stats_wait_end(rq, p);
     dequeue_wrr_entity(wrr_se);
 
+    /* Not rq->clock: the task may wake on a cpu whose clock is not ours */
+    if (flags & DEQUEUE_SLEEP)
+        wrr_se->fb_sleep_start = local_clock();
+
     dec_nr_running(rq);
 }
 
@@ -128,7 +211,7 @@ static void enqueue_wrr_entity(struct sched_wrr_entity *wrr_se, bool head)
 {
     struct wrr_rq *wrr_rq = wrr_rq_of_se(wrr_se);
     struct wrr_prio_array *array = &wrr_rq->active;
-    struct list_head *queue = array->queue + wrr_se_prio(wrr_se);
+    struct list_head *queue = wrr_prio_queue(array, wrr_se_prio(wrr_se));
 
     if (!wrr_rq->wrr_nr_running)
         list_add_leaf_wrr_rq(wrr_rq);
@@ -143,94 +226,184 @@ static void enqueue_wrr_entity(struct sched_wrr_entity *wrr_se, bool head)
     wrr_rq->wrr_nr_running++;
 }
 
+/*
+ * Randomized stage walk: how likely a task is to leave its stage grows
+ * with the stage and with how many times in a row it stayed there.
+ * Returns the change of queue level.
+ */
+static int wrr_random_step(struct rq *rq, struct task_struct *p, int prio)
+{
+    // get random number
+    s64 r = wrr_rand(rq);
+    struct wrr_rmlfq_odds *odds =
+        &wrr_rmlfq_odds[prio / 10][min_t(unsigned int, p->times, WRR_RMLFQ_MAX_TIMES)];
+
+    // p->times refers to the times it stays in the current stage
+    if (r < odds->up)
+    {
+        p->times = 1;
+        return prio > 9 ? -10 : 0;
+    }
+    if (r > odds->down)
+    {
+        p->times = 1;
+        return prio < 90 ? 10 : 0;
+    }
+
+    p->times += 1;
+    return 0;
+}
+
+/*
+ * Feedback on measured cpu usage: the share of the time since the last
+ * decision that @p spent running rather than sleeping moves it one stage
+ * towards longer slices when high, and towards the top stage when low.
+ */
+static int wrr_feedback_step(struct rq *rq, struct task_struct *p, int prio)
+{
+    struct sched_wrr_entity *wrr_se = &p->wrr;
+    u64 run = p->se.sum_exec_runtime - wrr_se->fb_exec_start;
+    u64 total = run + wrr_se->fb_sleep;
+    unsigned int usage;
+
+    wrr_se->fb_exec_start = p->se.sum_exec_runtime;
+    wrr_se->fb_sleep = 0;
+
+    if (!total)
+        return 0;
+
+    usage = div64_u64(run * 100, total);
+
+    if (usage >= sysctl_sched_wrr_rmlfq_demote_pct && prio < 90)
+        return 10;
+    if (usage <= sysctl_sched_wrr_rmlfq_promote_pct && prio > 9)
+        return -10;
+
+    return 0;
+}
+
+static inline int wrr_stage_step(struct rq *rq, struct task_struct *p, int prio)
+{
+    if (sysctl_sched_wrr_rmlfq_random)
+        return wrr_random_step(rq, p, prio);
+
+    return wrr_feedback_step(rq, p, prio);
+}
+
+/* Move @p to level @prio; it must not be queued, or be requeued after */
+static void wrr_set_task_prio(struct rq *rq, struct task_struct *p, int prio)
+{
+    int old_prio = wrr_task_prio(p);
+
+    p->wrr.prio = prio;
+    trace_sched_wrr_prio_change(p, old_prio, prio);
+    schedstat_inc(p, wrr.statistics.nr_prio_changes);
+    schedstat_inc(rq, wrr.wrr_nr_prio_changes);
+}
+
 /*
  * Adding/removing a task to/from a priority array;
  */
 static void enqueue_task_wrr(struct rq *rq, struct task_struct *p, int flags)
 {
-    printk("Enqueue a new wrr task!\n");
     struct sched_wrr_entity *wrr_se = &p->wrr;
+    int prio = wrr_task_prio(p);
+
+    /* A waking task is judged on its sleep before it is queued */
+    if ((flags & ENQUEUE_WAKEUP) && wrr_se->fb_sleep_start)
+    {
+        s64 delta = local_clock() - wrr_se->fb_sleep_start;
+
+        if (delta > 0)
+            wrr_se->fb_sleep += delta;
+        wrr_se->fb_sleep_start = 0;
+
+        if (!sysctl_sched_wrr_rmlfq_random)
+        {
+            int step = wrr_feedback_step(rq, p, prio);
+
+            if (step)
+                wrr_set_task_prio(rq, p, prio + step);
+        }
+    }
 
     enqueue_wrr_entity(wrr_se, flags & ENQUEUE_HEAD);
+    trace_sched_wrr_enqueue(p, wrr_se_prio(wrr_se), task_wrr_class(p));
+
+    if (!task_current(rq, p))
+        wrr_stats_wait_start(rq, p);
 
     inc_nr_running(rq);
 }
 
 /*
- * Put task to the head or the end of the run list without the overhead of
- * dequeue followed by enqueue.
+ * Put task to the head or the end of the run list of its next stage
+ * without the overhead of dequeue followed by enqueue.
  */
 static void requeue_task_wrr(struct rq *rq, struct task_struct *p, int head)
 {
-    printk("Requeue the tasks!\n");
+    struct sched_wrr_entity *wrr_se = &p->wrr;
+    struct wrr_prio_array *array = &rq->wrr.active;
+    int prio = wrr_task_prio(p);
+    int new_prio = prio + wrr_stage_step(rq, p, prio);
+    struct list_head *queue = wrr_prio_queue(array, new_prio);
 
-    // get random number
-    unsigned int r = getRand();
-    // printk("Get a random number! [%u]\n",r);
+    if (new_prio != prio)
+    {
+        list_del_init(&wrr_se->run_list);
+        if (list_empty(wrr_prio_queue(array, prio)))
+            __clear_bit(prio, array->bitmap);
+        __set_bit(new_prio, array->bitmap);
+        wrr_set_task_prio(rq, p, new_prio);
 
-    // get current priority
-    int prio = wrr_task_prio(p);
+        if (head)
+            list_add(&wrr_se->run_list, queue);
+        else
+            list_add_tail(&wrr_se->run_list, queue);
+    }
+    else if (head)
+        list_move(&wrr_se->run_list, queue);
+    else
+        list_move_tail(&wrr_se->run_list, queue);
 
-    struct sched_wrr_entity *wrr_se = &p->wrr;
-    struct wrr_rq *wrr_rq = &rq->wrr;
+    trace_sched_wrr_requeue(p, wrr_task_prio(p), task_wrr_class(p));
+}
 
-    struct wrr_prio_array *array = &wrr_rq->active;
-    struct list_head *queue = array->queue + prio;
+/*
+ * Move every queued task of @rq back to the top stage, keeping its level
+ * within the stage and its order within the level.
+ */
+static void wrr_boost_rq(struct rq *rq)
+{
+    struct wrr_prio_array *array = &rq->wrr.active;
+    struct sched_wrr_entity *wrr_se;
+    struct list_head *queue;
+    int prio;
 
-    // set high and low stage
-    struct list_head *high_queue = (prio < 90) ? array->queue+prio+10 : queue;
-    struct list_head *low_queue = (prio > 9) ? array->queue+prio-10 :queue;
+    for (prio = find_next_bit(array->bitmap, MAX_WRR_PRIO, 10);
+         prio < MAX_WRR_PRIO;
+         prio = find_next_bit(array->bitmap, MAX_WRR_PRIO, prio + 1))
+    {
+        queue = wrr_prio_queue(array, prio);
 
-    // p->times refers to the times it stays in the current stage
-    if(r < ((p->times+prio/20) * UNSIGNED_MAX /10)){ // go down to the low stage
-        p->times = 1; // reset the times
-        list_del_init(&wrr_se->run_list);
-        if (head)
-            list_add(&wrr_se->run_list, low_queue);
-        else 
-            list_add_tail(&wrr_se->run_list, low_queue);
-        
-        if(prio > 9){
-            // update the bitmap
-            if(list_empty(queue))
-                __clear_bit(prio, array->bitmap);
-            __set_bit(prio-10, array->bitmap);
-
-            // reset priority
-            p->rt_priority = p->rt_priority + 10;
-            printk("Priority Changed: [%d]\n",wrr_task_prio(p));
-        }
-    }
-    else if(r > ((5-p->times+prio/20) * UNSIGNED_MAX / 10)){ // go up to the high stage
-        p->times = 1; // reset the times
-        list_del_init(&wrr_se->run_list);
-        if (head)
-            list_add(&wrr_se->run_list, high_queue);
-        else 
-            list_add_tail(&wrr_se->run_list, high_queue);
-
-        if(prio < 90){
-            // update the bitmap
-            if(list_empty(queue))
-                __clear_bit(prio, array->bitmap);
-            __set_bit(prio+10, array->bitmap);
-
-            // reset priority
-            p->rt_priority = p->rt_priority - 10;
-            printk("Priority Changed: [%d]\n",wrr_task_prio(p));
+        list_for_each_entry(wrr_se, queue, run_list)
+        {
+            struct task_struct *p = wrr_task_of(wrr_se);
+
+            wrr_set_task_prio(rq, p, prio % 10);
+            p->times = 1;
+            wrr_se->fb_exec_start = p->se.sum_exec_runtime;
+            wrr_se->fb_sleep = 0;
         }
-    } else { // stay in the current stage
-        p->times += 1; // accumulate the times
-        if (head)
-            list_move(&wrr_se->run_list, queue);
-        else
-            list_move_tail(&wrr_se->run_list, queue);
+
+        list_splice_tail_init(queue, wrr_prio_queue(array, prio % 10));
+        __clear_bit(prio, array->bitmap);
+        __set_bit(prio % 10, array->bitmap);
     }
 }
 
 static void yield_task_wrr(struct rq *rq)
 {
-    printk("Yield a wrr task!\n");
     requeue_task_wrr(rq, rq->curr, 0);
 }
 
@@ -239,8 +412,13 @@ static void yield_task_wrr(struct rq *rq)
  */
 static void check_preempt_curr_wrr(struct rq *rq, struct task_struct *p, int flags)
 {
-    printk("Check wrr task preemption!\n");
-    if (wrr_task_prio(p) < wrr_task_prio(rq->curr))
+    struct task_struct *curr = rq->curr;
+    int preempt = wrr_wakeup_preempt(curr, wrr_task_prio(curr),
+                                     p, wrr_task_prio(p));
+
+    trace_sched_wrr_check_preempt(rq->curr, p, preempt);
+
+    if (preempt)
     {
         resched_task(rq->curr);
         return;
@@ -251,7 +429,7 @@ static struct task_struct *pick_next_task_wrr(struct rq *rq)
 {
     // printk("Select next wrr task!\n");
 
-    if (unlikely(!rq->wrr.wrr_nr_running))
+    if (unlikely(!rq->wrr.wrr_nr_running || wrr_rq_throttled(&rq->wrr)))
         return NULL;
 
     struct wrr_rq *wrr_rq = &rq->wrr;
@@ -261,94 +439,91 @@ static struct task_struct *pick_next_task_wrr(struct rq *rq)
     int idx;
 
     idx = sched_find_first_bit(array->bitmap);
-    printk("Find first bit %d\n",idx);
     BUG_ON(idx >= MAX_WRR_PRIO);
 
-    queue = array->queue + idx;
+    queue = wrr_prio_queue(array, idx);
     next = list_entry(queue->next, struct sched_wrr_entity, run_list);
 
     struct task_struct *p;
     p = wrr_task_of(next);
-    if(p) printk("Get task!\n");
 
     if (!p)
         return NULL;
     p->se.exec_start = rq->clock_task;
+    wrr_stats_wait_end(rq, p);
 
     return p;
 }
 
 static void put_prev_task_wrr(struct rq *rq, struct task_struct *p)
 {
-    printk("Put previous wrr task!\n");
+    trace_sched_wrr_put_prev(p, wrr_task_prio(p), task_wrr_class(p));
+
     update_curr_wrr(rq);
+    wrr_stats_switch_out(rq, p);
     // p->se.exec_start = 0;
+
+    if (p->on_rq)
+        wrr_stats_wait_start(rq, p);
 }
 
 static void set_curr_task_wrr(struct rq *rq)
 {
-    printk("Set current wrr task!\n");
     struct task_struct *p = rq->curr;
 
     p->se.exec_start = rq->clock_task;
+    wrr_stats_wait_end(rq, p);
 }
 
 static void task_tick_wrr(struct rq *rq, struct task_struct *p, int queued)
 {
-    // printk("Periodically update the wrr task!\n");
-    printk("Time Slice left: [%d]\n",p->wrr.time_slice);
     struct sched_wrr_entity *wrr_se = &p->wrr;
 
+    trace_sched_wrr_tick(p, wrr_se_prio(wrr_se), task_wrr_class(p));
+
     update_curr_wrr(rq);
 
     if (p->policy != SCHED_WRR)
         return;
 
-    printk("Current Priority [%d]\n",wrr_task_prio(p));
+    if (sysctl_sched_wrr_rmlfq_boost_ms &&
+        time_after_eq(jiffies, __get_cpu_var(wrr_next_boost)))
+    {
+        __get_cpu_var(wrr_next_boost) = jiffies +
+            msecs_to_jiffies(sysctl_sched_wrr_rmlfq_boost_ms);
+        wrr_boost_rq(rq);
+        set_tsk_need_resched(p);
+    }
 
     if (--p->wrr.time_slice)
         return;
 
-    int stage = wrr_task_prio(p) / 10 + 1; // to get timeslice
+    schedstat_inc(p, wrr.statistics.nr_slice_expired);
+    schedstat_inc(rq, wrr.wrr_nr_slice_expired);
 
-    if (task_group_path(p->sched_task_group)[1] != 'b') // Foreground
-        p->wrr.time_slice = WRR_FORE_TIMESLICE * stage;
-    else // Background
-        p->wrr.time_slice = WRR_BACK_TIMESLICE;
-
-    // Requeue the task queue
+    // Requeue the task queue, then refill for the stage it ended up in
     set_tsk_need_resched(p);
     requeue_task_wrr(rq, p, 0);
-    return;
+    p->wrr.time_slice = wrr_stage_timeslice(p);
 }
 
 static unsigned int get_rr_interval_wrr(struct rq *rq, struct task_struct *task)
 {
-    printk("Get wrr interval!\n");
     if (task == NULL)
         return -EINVAL;
 
-    int stage = (wrr_task_prio(task)) / 10 + 1; // to get timeslice
-
-    if (task_group_path(task->sched_task_group)[1] != 'b')
-        return WRR_FORE_TIMESLICE * stage;
-    else
-        return WRR_BACK_TIMESLICE;
-}
-
-static void task_fork_wrr(struct task_struct *p)
-{
-    // printk("Fork a new wrr task!\n");
-    // p->wrr.time_slice = p->wrr.parent->time_slice;
+    return wrr_stage_timeslice(task);
 }
 
+/*
+ * check_preempt_curr() preempts a task of a lower class outright and asks
+ * check_preempt_curr_wrr() when the current task is SCHED_WRR as well.
+ */
 static void switched_to_wrr(struct rq *rq, struct task_struct *p)
 {
-    printk("Switch to wrr task!\n");
     if (p->on_rq && rq->curr != p)
     {
-        if (wrr_task_prio(p) < wrr_task_prio(rq->curr))
-            resched_task(rq->curr);
+        check_preempt_curr(rq, p, 0);
     }
 }
 
@@ -361,24 +536,222 @@ int alloc_wrr_sched_group(struct task_group *tg, struct task_group *parent)
     return 1;
 }
 
-// Dummy functions
-static int select_task_rq_wrr(struct task_struct *p, int sd_flag, int flags) {}
+#ifdef CONFIG_SMP
+/* Bandwidth runtime is only lent between online cpus */
+static void rq_offline_wrr(struct rq *rq)
+{
+    disable_wrr_runtime(rq);
+}
 
-static void set_cpus_allowed_wrr(struct task_struct *p, const struct cpumask *new_mask) {}
+static void rq_online_wrr(struct rq *rq)
+{
+    enable_wrr_runtime(rq);
+}
 
-static void rq_offline_wrr(struct rq *rq) {}
+/* This class balances on runnable tasks rather than on weight */
+static inline unsigned long wrr_cpu_load(int cpu)
+{
+    return ACCESS_ONCE(cpu_rq(cpu)->nr_running);
+}
 
-static void rq_online_wrr(struct rq *rq) {}
+/*
+ * Place waking, forked and exec'ing tasks on the allowed cpu with the
+ * fewest runnable tasks, nearest first, see wrr_find_lightest_cpu().
+ * This is also how WRR tasks spread back over a cpu that came online after
+ * migrate_tasks() moved them off it.
+ */
+static int select_task_rq_wrr(struct task_struct *p, int sd_flag, int flags)
+{
+    int cpu = task_cpu(p);
+    int target;
+
+    if (p->rt.nr_cpus_allowed == 1)
+        return cpu;
+
+    /* For anything but wake ups, fork and exec, just return the task_cpu */
+    if (sd_flag != SD_BALANCE_WAKE && sd_flag != SD_BALANCE_FORK &&
+        sd_flag != SD_BALANCE_EXEC)
+        return cpu;
+
+    if (cpumask_test_cpu(cpu, tsk_cpus_allowed(p)) && cpu_active(cpu) && idle_cpu(cpu))
+        return cpu;
 
+    target = wrr_find_lightest_cpu(p, cpu, wrr_cpu_load);
+    if (target != -1)
+        cpu = target;
+
+    return cpu;
+}
+
+/*
+ * This class keeps no per-cpu migration state to update. When @p may no
+ * longer run where it is queued, set_cpus_allowed_ptr() has the stopper
+ * move it, and select_task_rq_wrr() honours @new_mask from then on.
+ */
+static void set_cpus_allowed_wrr(struct task_struct *p, const struct cpumask *new_mask)
+{
+}
+
+// Dummy functions
 static void pre_schedule_wrr(struct rq *rq, struct task_struct *prev) {}
 
 static void post_schedule_wrr(struct rq *rq) {}
 
 static void task_woken_wrr(struct rq *rq, struct task_struct *p) {}
 
+void trigger_wrr_load_balance(struct rq *rq, int cpu) {}
+
+void idle_pull_wrr_task(struct rq *this_rq) {}
+#endif /* CONFIG_SMP */
+
+static void __init init_wrr_rmlfq_odds(void)
+{
+    int stage, times;
+    s64 n;
+
+    for (stage = 0; stage < WRR_RMLFQ_STAGES; stage++)
+    {
+        for (times = 0; times <= WRR_RMLFQ_MAX_TIMES; times++)
+        {
+            struct wrr_rmlfq_odds *odds = &wrr_rmlfq_odds[stage][times];
+
+            // up a stage with chance (times + stage/2) / 10
+            n = times + stage / 2;
+            odds->up = div_u64((u64)n * UINT_MAX, 10);
+
+            // down a stage when r > down, a chance of
+            // 1 - (5 - times + stage/2) / 10, unless r < up moved it up first
+            n = 5 - times + stage / 2;
+            odds->down = n < 0 ? -1 : (s64)div_u64((u64)n * UINT_MAX, 10);
+        }
+    }
+}
+
+__init void init_sched_wrr_class(void)
+{
+    unsigned int i;
+
+    init_wrr_rmlfq_odds();
+
+    /* The entropy pool is not up yet, wrr_rand_reseed() follows later */
+    for_each_possible_cpu(i)
+        prandom32_seed(&per_cpu(wrr_rnd_state, i),
+                       ((u64)get_cycles() << 32) ^ (i + 1) * 0x9e3779b9UL);
+}
+
+static int __init wrr_rand_reseed(void)
+{
+    unsigned int i;
+
+    for_each_possible_cpu(i)
+    {
+        struct rq *rq = cpu_rq(i);
+        u64 seed;
+
+        get_random_bytes(&seed, sizeof(seed));
+
+        raw_spin_lock_irq(&rq->lock);
+        prandom32_seed(&per_cpu(wrr_rnd_state, i), seed);
+        raw_spin_unlock_irq(&rq->lock);
+    }
+
+    return 0;
+}
+late_initcall(wrr_rand_reseed);
+
+#ifdef CONFIG_SYSCTL
+static int zero;
+static int one = 1;
+static int one_hundred = 100;
+static int max_rmlfq_slice_ms = 10000;
+static int max_rmlfq_boost_ms = 60000;
+
+static struct ctl_table sched_wrr_rmlfq_sysctls[] = {
+    {
+        .procname     = "sched_wrr_rmlfq_slice_ms",
+        .data         = &sysctl_sched_wrr_rmlfq_slice_ms,
+        .maxlen       = sizeof(sysctl_sched_wrr_rmlfq_slice_ms),
+        .mode         = 0644,
+        .proc_handler = proc_dointvec_minmax,
+        .extra1       = &one,
+        .extra2       = &max_rmlfq_slice_ms,
+    },
+    {
+        .procname     = "sched_wrr_rmlfq_demote_pct",
+        .data         = &sysctl_sched_wrr_rmlfq_demote_pct,
+        .maxlen       = sizeof(unsigned int),
+        .mode         = 0644,
+        .proc_handler = proc_dointvec_minmax,
+        .extra1       = &zero,
+        .extra2       = &one_hundred,
+    },
+    {
+        .procname     = "sched_wrr_rmlfq_promote_pct",
+        .data         = &sysctl_sched_wrr_rmlfq_promote_pct,
+        .maxlen       = sizeof(unsigned int),
+        .mode         = 0644,
+        .proc_handler = proc_dointvec_minmax,
+        .extra1       = &zero,
+        .extra2       = &one_hundred,
+    },
+    {
+        .procname     = "sched_wrr_rmlfq_boost_ms",
+        .data         = &sysctl_sched_wrr_rmlfq_boost_ms,
+        .maxlen       = sizeof(unsigned int),
+        .mode         = 0644,
+        .proc_handler = proc_dointvec_minmax,
+        .extra1       = &zero,
+        .extra2       = &max_rmlfq_boost_ms,
+    },
+    {
+        .procname     = "sched_wrr_rmlfq_random",
+        .data         = &sysctl_sched_wrr_rmlfq_random,
+        .maxlen       = sizeof(unsigned int),
+        .mode         = 0644,
+        .proc_handler = proc_dointvec_minmax,
+        .extra1       = &zero,
+        .extra2       = &one,
+    },
+    {}
+};
+
+static struct ctl_table sched_wrr_rmlfq_sysctl_root[] = {
+    {
+        .procname = "kernel",
+        .mode     = 0555,
+        .child    = sched_wrr_rmlfq_sysctls,
+    },
+    {}
+};
+
+static int __init sched_wrr_rmlfq_sysctl_init(void)
+{
+    register_sysctl_table(sched_wrr_rmlfq_sysctl_root);
+    return 0;
+}
+late_initcall(sched_wrr_rmlfq_sysctl_init);
+#endif /* CONFIG_SYSCTL */
+
 static void switched_from_wrr(struct rq *rq, struct task_struct *p) {}
 
-static void prio_changed_wrr(struct rq *rq, struct task_struct *p, int oldprio) {}
+/*
+ * __sched_setscheduler() has requeued @p on its new level: give up the cpu
+ * if @p runs and an earlier level is queued now, else see if @p preempts.
+ */
+static void prio_changed_wrr(struct rq *rq, struct task_struct *p, int oldprio)
+{
+    if (!p->on_rq)
+        return;
+
+    if (rq->curr == p)
+    {
+        if (wrr_level_before(sched_find_first_bit(rq->wrr.active.bitmap),
+                             wrr_task_prio(p)))
+            resched_task(p);
+    }
+    else
+        check_preempt_curr(rq, p, 0);
+}
 
 const struct sched_class wrr_sched_class = {
     .next = &fair_sched_class,                    /*Required*/
@@ -390,12 +763,12 @@ const struct sched_class wrr_sched_class = {
     .pick_next_task = pick_next_task_wrr, /*Required*/
     .put_prev_task = put_prev_task_wrr,   /*Required*/
 
-    .task_fork = task_fork_wrr,
+    .task_fork = wrr_task_fork,
 #ifdef CONFIG_SMP
-    .select_task_rq = select_task_rq_wrr, /*Never need impl*/
+    .select_task_rq = select_task_rq_wrr,
     .set_cpus_allowed = set_cpus_allowed_wrr,
-    .rq_online = rq_online_wrr,         /*Never need impl*/
-    .rq_offline = rq_offline_wrr,       /*Never need impl*/
+    .rq_online = rq_online_wrr,
+    .rq_offline = rq_offline_wrr,
     .pre_schedule = pre_schedule_wrr,   /*Never need impl*/
     .post_schedule = post_schedule_wrr, /*Never need impl*/
     .task_woken = task_woken_wrr,       /*Never need impl*/
@@ -407,6 +780,6 @@ const struct sched_class wrr_sched_class = {
 
     .get_rr_interval = get_rr_interval_wrr,
 
-    .prio_changed = prio_changed_wrr, /*Never need impl*/
-    .switched_to = switched_to_wrr,   /*Never need impl*/
+    .prio_changed = prio_changed_wrr,
+    .switched_to = switched_to_wrr,
 };
@@ -5,6 +5,23 @@
 #include "sched.h"
 #include <linux/slab.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/sched_wrr.h>
+
+#ifndef CONFIG_WRR_GROUP_SCHED
+#error "wrr_group.c needs CONFIG_WRR_GROUP_SCHED for per-group runqueues"
+#endif
+
+/*
+ * Every task group has a wrr_rq and a group entity on each cpu. A group
+ * entity is queued on its parent's runqueue at the best level queued on
+ * its own runqueue and gets a slice of its group's wrr_timeslice. At
+ * each level entities take turns, so a group with many runnable tasks
+ * gets the same share as a group with one; the tasks inside share their
+ * group's slice, since every tick is charged to every entity on the path
+ * from the running task up to the root.
+ */
+
 #define for_each_sched_wrr_entity(wrr_se) \
     for (; wrr_se; wrr_se = wrr_se->parent)
 
@@ -16,21 +33,6 @@ extern void init_tg_wrr_entry(struct task_group *tg, struct wrr_rq *wrr_rq,
                 struct sched_wrr_entity *wrr_se, int cpu,
                 struct sched_wrr_entity *parent);
 
-// To determine whether the process is in foreground or background
-static char group_path[10000];
-static char *task_group_path(struct task_group *tg)
-{
-        if (autogroup_path(tg, group_path, 10000))
-                return group_path;
-
-        if (!tg->css.cgroup) {
-                group_path[0] = '\0';
-                return group_path;
-        }
-        cgroup_path(tg->css.cgroup, group_path, 10000);
-        return group_path;
-}
-
 static inline int on_wrr_rq(struct sched_wrr_entity *wrr_se)
 {
     return !list_empty(&wrr_se->run_list);
@@ -49,12 +51,10 @@ static inline struct rq *rq_of_wrr_rq(struct wrr_rq *wrr_rq)
     return wrr_rq->rq;
 }
 
+/* The runqueue @wrr_se is queued on; set_task_rq() keeps it for tasks */
 static inline struct wrr_rq *wrr_rq_of_se(struct sched_wrr_entity *wrr_se)
 {
-    struct task_struct *p = wrr_task_of(wrr_se);
-    struct rq *rq = task_rq(rq);
-
-    return &rq->wrr;
+    return wrr_se->wrr_rq;
 }
 
 static inline struct wrr_rq *group_wrr_rq(struct sched_wrr_entity *wrr_se)
@@ -62,9 +62,31 @@ static inline struct wrr_rq *group_wrr_rq(struct sched_wrr_entity *wrr_se)
     return wrr_se->my_q;
 }
 
+/* The entity representing @wrr_rq on its parent, NULL for the root */
+static inline struct sched_wrr_entity *wrr_rq_group_se(struct wrr_rq *wrr_rq)
+{
+    return wrr_rq->tg->wrr_se[cpu_of(rq_of_wrr_rq(wrr_rq))];
+}
+
 static inline int wrr_se_prio(struct sched_wrr_entity *wrr_se)
 {
-    return wrr_task_of(wrr_se)->rt_priority;
+    struct wrr_rq *my_q = group_wrr_rq(wrr_se);
+
+    if (my_q)
+        return my_q->highest_prio.curr;
+
+    return wrr_prio_level(wrr_task_of(wrr_se)->rt_priority);
+}
+
+/* Slice of an entity: its group's for a group entity, the task's otherwise */
+static inline unsigned int wrr_se_timeslice(struct sched_wrr_entity *wrr_se)
+{
+    struct wrr_rq *my_q = group_wrr_rq(wrr_se);
+
+    if (my_q)
+        return my_q->tg->wrr_timeslice;
+
+    return task_wrr_timeslice(wrr_task_of(wrr_se));
 }
 
 static inline void list_add_leaf_wrr_rq(struct wrr_rq *wrr_rq)
@@ -105,21 +127,23 @@ static void dec_wrr_prio(struct wrr_rq *wrr_rq, int prio)
         wrr_rq->highest_prio.curr = MAX_WRR_PRIO;
 }
 
-static inline void inc_wrr_tasks(struct sched_wrr_entity *wrr_se, struct wrr_rq *wrr_rq)
+static inline void inc_wrr_tasks(struct sched_wrr_entity *wrr_se, int prio,
+                                 struct wrr_rq *wrr_rq)
 {
-    int prio = wrr_se_prio(wrr_se);
-
     wrr_rq->wrr_nr_running++;
+    wrr_rq->wrr_weight += wrr_se->weight;
 
     inc_wrr_prio(wrr_rq, prio);
 }
 
-static inline void dec_wrr_tasks(struct sched_wrr_entity *wrr_se, struct wrr_rq *wrr_rq)
+static inline void dec_wrr_tasks(struct sched_wrr_entity *wrr_se, int prio,
+                                 struct wrr_rq *wrr_rq)
 {
     WARN_ON(!wrr_rq->wrr_nr_running);
     wrr_rq->wrr_nr_running--;
+    wrr_rq->wrr_weight -= wrr_se->weight;
 
-    dec_wrr_prio(wrr_rq, wrr_se_prio(wrr_se));
+    dec_wrr_prio(wrr_rq, prio);
 }
 
 /*
@@ -129,6 +153,7 @@ static inline void dec_wrr_tasks(struct sched_wrr_entity *wrr_se, struct wrr_rq
 static void update_curr_wrr(struct rq *rq)
 {
     struct task_struct *curr = rq->curr;
+    struct sched_wrr_entity *wrr_se = &curr->wrr;
     u64 delta_exec;
 
     if(curr->sched_class != &wrr_sched_class)
@@ -146,32 +171,37 @@ static void update_curr_wrr(struct rq *rq)
 
     curr->se.exec_start = rq->clock_task;
     cpuacct_charge(curr, delta_exec);
+
+    for_each_sched_wrr_entity(wrr_se)
+    {
+        if (sched_wrr_charge_runtime(wrr_rq_of_se(wrr_se), delta_exec))
+            resched_task(curr);
+    }
 }
 
-static void __dequeue_wrr_entity(struct sched_wrr_entity *wrr_se)
+/*
+ * Group entities are moved between levels after their runqueue changed,
+ * so the level to unlink from is passed in rather than recomputed.
+ */
+static void __dequeue_wrr_entity(struct sched_wrr_entity *wrr_se, int prio)
 {
     struct wrr_rq *wrr_rq = wrr_rq_of_se(wrr_se);
     struct wrr_prio_array *array = &wrr_rq->active;
 
     list_del_init(&wrr_se->run_list);
-    if (list_empty(array->queue + wrr_se_prio(wrr_se)))
-        __clear_bit(wrr_se_prio(wrr_se), array->bitmap);
+    if (list_empty(wrr_prio_queue(array, prio)))
+        __clear_bit(prio, array->bitmap);
 
-    dec_wrr_tasks(wrr_se, wrr_rq);
+    dec_wrr_tasks(wrr_se, prio, wrr_rq);
     if (!wrr_rq->wrr_nr_running)
         list_del_leaf_wrr_rq(wrr_rq);
 }
 
-static void __enqueue_wrr_entity(struct sched_wrr_entity *wrr_se, bool head)
+static void __enqueue_wrr_entity(struct sched_wrr_entity *wrr_se, int prio, bool head)
 {
-    printk("Enqueue a new wrr entity!\n");
     struct wrr_rq *wrr_rq = wrr_rq_of_se(wrr_se);
     struct wrr_prio_array *array = &wrr_rq->active;
-    struct wrr_rq *group_rq = group_wrr_rq(wrr_se);
-    struct list_head *queue = array->queue + wrr_se_prio(wrr_se);
-
-    if (group_rq && !group_rq->wrr_nr_running)
-        return;
+    struct list_head *queue = wrr_prio_queue(array, prio);
 
     if (!wrr_rq->wrr_nr_running)
         list_add_leaf_wrr_rq(wrr_rq);
@@ -181,51 +211,108 @@ static void __enqueue_wrr_entity(struct sched_wrr_entity *wrr_se, bool head)
     else
         list_add_tail(&wrr_se->run_list, queue);
     
-    __set_bit(wrr_se_prio(wrr_se), array->bitmap);
+    __set_bit(prio, array->bitmap);
 
-    inc_wrr_tasks(wrr_se, wrr_rq);
+    /* A group keeps what is left of its slice while it is empty */
+    if (!wrr_se->time_slice)
+        wrr_se->time_slice = wrr_se_timeslice(wrr_se);
+    wrr_se->weight = wrr_se_timeslice(wrr_se);
+    inc_wrr_tasks(wrr_se, prio, wrr_rq);
 }
 
 /*
- * Because the prio of an upper entry depends on the lower
- * entries, we must remove entries top-down
+ * The best level of @wrr_rq was @prev_prio before an entity was added to
+ * or removed from it. If it changed, the group entity of @wrr_rq moves to
+ * the tail of its new level on the parent runqueue, or in or out of that
+ * runqueue, and the parent is checked in turn. Groups whose level did not
+ * change keep their place in the round robin, and throttled groups stay
+ * off their parent until sched_wrr_rq_enqueue().
  */
-static void dequeue_wrr_stack(struct sched_wrr_entity *wrr_se)
+static void update_wrr_group(struct wrr_rq *wrr_rq, int prev_prio)
 {
-    struct sched_wrr_entity *back = NULL;
+    struct sched_wrr_entity *wrr_se;
+    struct wrr_rq *parent_rq;
+    int parent_prev_prio;
 
-    for_each_sched_wrr_entity(wrr_se)
+    while (wrr_rq->highest_prio.curr != prev_prio)
     {
-        wrr_se->back = back;
-        back = wrr_se;
-    }
+        wrr_se = wrr_rq_group_se(wrr_rq);
+        if (!wrr_se)
+            break;
+
+        parent_rq = wrr_rq_of_se(wrr_se);
+        parent_prev_prio = parent_rq->highest_prio.curr;
 
-    for (wrr_se = back; wrr_se; wrr_se = wrr_se->back)
-    {
         if (on_wrr_rq(wrr_se))
-            __dequeue_wrr_entity(wrr_se);
+            __dequeue_wrr_entity(wrr_se, prev_prio);
+        if (wrr_rq->wrr_nr_running && !wrr_rq_throttled(wrr_rq))
+            __enqueue_wrr_entity(wrr_se, wrr_rq->highest_prio.curr, false);
+
+        wrr_rq = parent_rq;
+        prev_prio = parent_prev_prio;
     }
 }
 
-static void dequeue_wrr_entity(struct sched_wrr_entity *wrr_se)
+/*
+ * Take the group entity of a throttled @wrr_rq off its parent, or put it
+ * back once the period timer refilled its runtime. A throttled root
+ * wrr_rq is skipped by pick_next_task_wrr() instead.
+ */
+void sched_wrr_rq_dequeue(struct wrr_rq *wrr_rq)
 {
-    dequeue_wrr_stack(wrr_se);
+    struct sched_wrr_entity *wrr_se = wrr_rq_group_se(wrr_rq);
+    struct wrr_rq *parent_rq;
+    int prev_prio;
 
-    for_each_sched_wrr_entity(wrr_se)
+    if (!wrr_se || !on_wrr_rq(wrr_se))
+        return;
+
+    parent_rq = wrr_rq_of_se(wrr_se);
+    prev_prio = parent_rq->highest_prio.curr;
+
+    __dequeue_wrr_entity(wrr_se, wrr_rq->highest_prio.curr);
+    update_wrr_group(parent_rq, prev_prio);
+}
+
+void sched_wrr_rq_enqueue(struct wrr_rq *wrr_rq)
+{
+    struct sched_wrr_entity *wrr_se = wrr_rq_group_se(wrr_rq);
+    struct rq *rq = rq_of_wrr_rq(wrr_rq);
+    struct wrr_rq *parent_rq;
+    int prev_prio;
+
+    if (!wrr_rq->wrr_nr_running)
+        return;
+
+    if (wrr_se && !on_wrr_rq(wrr_se))
     {
-        struct wrr_rq *wrr_rq = group_wrr_rq(wrr_se);
+        parent_rq = wrr_rq_of_se(wrr_se);
+        prev_prio = parent_rq->highest_prio.curr;
 
-        if (wrr_rq && wrr_rq->wrr_nr_running)
-            __enqueue_wrr_entity(wrr_se, false);
+        __enqueue_wrr_entity(wrr_se, wrr_rq->highest_prio.curr, false);
+        update_wrr_group(parent_rq, prev_prio);
     }
+
+    resched_task(rq->curr);
+}
+
+static void dequeue_wrr_entity(struct sched_wrr_entity *wrr_se)
+{
+    struct wrr_rq *wrr_rq = wrr_rq_of_se(wrr_se);
+    int prev_prio = wrr_rq->highest_prio.curr;
+
+    __dequeue_wrr_entity(wrr_se, wrr_se_prio(wrr_se));
+    update_wrr_group(wrr_rq, prev_prio);
 }
 
 static void dequeue_task_wrr(struct rq *rq, struct task_struct *p, int flags)
 {
-    printk("Dequeue a wrr task!\n");
     struct sched_wrr_entity *wrr_se = &p->wrr;
 
+    trace_sched_wrr_dequeue(p, wrr_se_prio(wrr_se), task_wrr_class(p));
+
     update_curr_wrr(rq);
+    wrr_stats_wait_end(rq, p);
     dequeue_wrr_entity(wrr_se);
 
     dec_nr_running(rq);
@@ -233,9 +320,11 @@ static void dequeue_task_wrr(struct rq *rq, struct task_struct *p, int flags)
 
 static void enqueue_wrr_entity(struct sched_wrr_entity *wrr_se, bool head)
 {
-    dequeue_wrr_stack(wrr_se);
-    for_each_sched_wrr_entity(wrr_se)
-        __enqueue_wrr_entity(wrr_se, head);
+    struct wrr_rq *wrr_rq = wrr_rq_of_se(wrr_se);
+    int prev_prio = wrr_rq->highest_prio.curr;
+
+    __enqueue_wrr_entity(wrr_se, wrr_se_prio(wrr_se), head);
+    update_wrr_group(wrr_rq, prev_prio);
 }
 
 /*
@@ -243,10 +332,14 @@ static void enqueue_wrr_entity(struct sched_wrr_entity *wrr_se, bool head)
  */
 static void enqueue_task_wrr(struct rq *rq, struct task_struct *p, int flags)
 {
-    printk("Enqueue a new wrr task!\n");
     struct sched_wrr_entity *wrr_se = &p->wrr;
-    // printk("%d", p->rt_priority);
+
     enqueue_wrr_entity(wrr_se, flags & ENQUEUE_HEAD);
+    trace_sched_wrr_enqueue(p, wrr_se_prio(&p->wrr), task_wrr_class(p));
+
+    if (!task_current(rq, p))
+        wrr_stats_wait_start(rq, p);
+
     inc_nr_running(rq);
 }
 
@@ -255,7 +348,7 @@ static void requeue_wrr_entity(struct wrr_rq *wrr_rq, struct sched_wrr_entity *w
     if (on_wrr_rq(wrr_se))
     {
         struct wrr_prio_array *array = &wrr_rq->active;
-        struct list_head *queue = array->queue + wrr_se_prio(wrr_se);
+        struct list_head *queue = wrr_prio_queue(array, wrr_se_prio(wrr_se));
 
         if (head)
             list_move(&wrr_se->run_list, queue);
@@ -270,10 +363,11 @@ static void requeue_wrr_entity(struct wrr_rq *wrr_rq, struct sched_wrr_entity *w
  */
 static void requeue_task_wrr(struct rq *rq, struct task_struct *p, int head)
 {
-    printk("Requeue the tasks!\n");
     struct sched_wrr_entity *wrr_se = &p->wrr;
     struct wrr_rq *wrr_rq;
 
+    trace_sched_wrr_requeue(p, wrr_se_prio(wrr_se), task_wrr_class(p));
+
     for_each_sched_wrr_entity(wrr_se)
     {
         wrr_rq = wrr_rq_of_se(wrr_se);
@@ -286,13 +380,45 @@ static void yield_task_wrr(struct rq *rq)
     requeue_task_wrr(rq, rq->curr, 0);
 }
 
+/*
+ * Walk @curr_se and @wrr_se up to the ancestors that share a wrr_rq, so that
+ * tasks in different groups are ordered by the levels their groups compete
+ * on. The root wrr_rq is shared by every hierarchy on a cpu.
+ */
+static void find_matching_wrr_se(struct sched_wrr_entity **curr_se,
+                                 struct sched_wrr_entity **wrr_se)
+{
+    struct sched_wrr_entity *se;
+
+    for (; *curr_se; *curr_se = (*curr_se)->parent)
+    {
+        for (se = *wrr_se; se; se = se->parent)
+        {
+            if (wrr_rq_of_se(se) == wrr_rq_of_se(*curr_se))
+            {
+                *wrr_se = se;
+                return;
+            }
+        }
+    }
+}
+
 /*
  * Preempt the current task with a newly woken task if needed:
  */
 static void check_preempt_curr_wrr(struct rq *rq, struct task_struct *p, int flags)
 {
-    printk("Check wrr task preemption!\n");
-    if (p->rt_priority > rq->curr->rt_priority)
+    struct sched_wrr_entity *curr_se = &rq->curr->wrr;
+    struct sched_wrr_entity *wrr_se = &p->wrr;
+    int preempt;
+
+    find_matching_wrr_se(&curr_se, &wrr_se);
+    preempt = wrr_wakeup_preempt(rq->curr, wrr_se_prio(curr_se),
+                                 p, wrr_se_prio(wrr_se));
+
+    trace_sched_wrr_check_preempt(rq->curr, p, preempt);
+
+    if (preempt)
     {
         resched_task(rq->curr);
         return;
@@ -309,7 +435,7 @@ static struct sched_wrr_entity *pick_next_wrr_entity(struct rq *rq, struct wrr_r
     idx = sched_find_first_bit(array->bitmap);
     BUG_ON(idx >= MAX_WRR_PRIO);
 
-    queue = array->queue + idx;
+    queue = wrr_prio_queue(array, idx);
     next = list_entry(queue->next, struct sched_wrr_entity, run_list);
 
     return next;
@@ -323,7 +449,7 @@ static struct task_struct *_pick_next_task_wrr(struct rq *rq)
 
     wrr_rq = &rq->wrr;
 
-    if (!wrr_rq->wrr_nr_running)
+    if (!wrr_rq->wrr_nr_running || wrr_rq_throttled(wrr_rq))
         return NULL;
 
     do
@@ -335,6 +461,7 @@ static struct task_struct *_pick_next_task_wrr(struct rq *rq)
 
     p = wrr_task_of(wrr_se);
     p->se.exec_start = rq->clock_task;
+    wrr_stats_wait_end(rq, p);
 
     return p;
 }
@@ -348,84 +475,99 @@ static struct task_struct *pick_next_task_wrr(struct rq *rq)
 
 static void put_prev_task_wrr(struct rq *rq, struct task_struct *p)
 {
-    printk("Put previous wrr task!\n");
+    trace_sched_wrr_put_prev(p, wrr_se_prio(&p->wrr), task_wrr_class(p));
+
     update_curr_wrr(rq);
+    wrr_stats_switch_out(rq, p);
+
+    if (p->on_rq)
+        wrr_stats_wait_start(rq, p);
 }
 
 static void set_curr_task_wrr(struct rq *rq)
 {
-    printk("Set current wrr task!\n");
     struct task_struct *p = rq->curr;
     p->se.exec_start = rq->clock_task;
+    wrr_stats_wait_end(rq, p);
 }
 
+/*
+ * The tick is charged to the task and to every group entity above it.
+ * An entity whose slice runs out gets a new one and goes to the tail of
+ * its level, so the next task of the group or the next group runs.
+ */
 static void task_tick_wrr(struct rq *rq, struct task_struct *p, int queued)
 {
-    printk("Time Slice left: [%d]\n",p->wrr.time_slice);
-
     struct sched_wrr_entity *wrr_se = &p->wrr;
+    int resched = 0;
+
+    trace_sched_wrr_tick(p, wrr_se_prio(wrr_se), task_wrr_class(p));
 
     update_curr_wrr(rq);
 
     if (p->policy != SCHED_WRR)
         return;
 
-    if (--p->wrr.time_slice)
-        return;
-
-    if (task_group_path(p->sched_task_group)[1] != 'b') // Foreground
-    {
-        p->wrr.time_slice = WRR_FORE_TIMESLICE;
-    }
-    else // Background
-    {
-        p->wrr.time_slice = WRR_BACK_TIMESLICE;
-    }
-
-    // Requeue to the end of queue if we are not the only element on the queue
     for_each_sched_wrr_entity(wrr_se)
     {
+        if (--wrr_se->time_slice)
+            continue;
+
+        if (wrr_entity_is_task(wrr_se))
+        {
+            schedstat_inc(p, wrr.statistics.nr_slice_expired);
+            schedstat_inc(rq, wrr.wrr_nr_slice_expired);
+        }
+
+        wrr_se->time_slice = wrr_se_timeslice(wrr_se);
+
+        // Requeue to the end of its level if it is not alone there
         if (wrr_se->run_list.prev != wrr_se->run_list.next)
         {
-            requeue_task_wrr(rq, p, 0);
-            set_tsk_need_resched(p);
-            return;
+            requeue_wrr_entity(wrr_rq_of_se(wrr_se), wrr_se, 0);
+            resched = 1;
         }
     }
+
+    if (resched)
+        set_tsk_need_resched(p);
 }
 
 static unsigned int get_rr_interval_wrr(struct rq *rq, struct task_struct *task)
 {
-    printk("Get wrr interval!");
-
     if (task == NULL)
         return -EINVAL;
 
-    if (task_group_path(task->sched_task_group)[1] != 'b')
-        return WRR_FORE_TIMESLICE;
-    else
-        return WRR_BACK_TIMESLICE;
-}
-
-static void task_fork_wrr(struct task_struct *p)
-{
-    printk("Fork a new wrr task!\n");
-    p->wrr.time_slice = p->wrr.parent->time_slice;
+    return task_wrr_timeslice(task);
 }
 
+/*
+ * check_preempt_curr() preempts a task of a lower class outright and asks
+ * check_preempt_curr_wrr() when the current task is SCHED_WRR as well.
+ */
 static void switched_to_wrr(struct rq *rq, struct task_struct *p)
 {
     if (p->on_rq && rq->curr != p)
     {
-        if (p->rt_priority > rq->curr->rt_priority)
-            resched_task(rq->curr);
+        check_preempt_curr(rq, p, 0);
     }
 }
 
 void free_wrr_sched_group(struct task_group *tg)
 {
-    printk("Switch to wrr task!\n");
-    // printk("%d", p->rt_priority);
+    int i;
+
+    for_each_possible_cpu(i)
+    {
+        if (tg->wrr_rq && tg->wrr_rq[i])
+        {
+            free_wrr_prio_chunks(&tg->wrr_rq[i]->active);
+            kfree(tg->wrr_rq[i]);
+        }
+        if (tg->wrr_se)
+            kfree(tg->wrr_se[i]);
+    }
+
     kfree(tg->wrr_rq);
     kfree(tg->wrr_se);
 }
@@ -434,6 +576,7 @@ int alloc_wrr_sched_group(struct task_group *tg, struct task_group *parent)
 {
     struct wrr_rq *wrr_rq;
     struct sched_wrr_entity *wrr_se;
+    int i;
 
     tg->wrr_rq = kzalloc(sizeof(wrr_rq) * nr_cpu_ids, GFP_KERNEL);
     if (!tg->wrr_rq)
@@ -441,14 +584,22 @@ int alloc_wrr_sched_group(struct task_group *tg, struct task_group *parent)
     tg->wrr_se = kzalloc(sizeof(wrr_se) * nr_cpu_ids, GFP_KERNEL);
     if (!tg->wrr_se)
         goto err;
-    
-    wrr_rq = kzalloc_node(sizeof(struct wrr_rq), GFP_KERNEL, cpu_to_node(0));
-    if(!wrr_rq) goto err;
-    wrr_se = kzalloc_node(sizeof(struct sched_wrr_entity), GFP_KERNEL, cpu_to_node(0));
-    if(!wrr_se) goto err_free_rq;
 
-    init_wrr_rq(wrr_rq, cpu_rq(0));
-    init_tg_wrr_entry(tg, wrr_rq, wrr_se, 0, parent-> wrr_se[0]);
+    for_each_possible_cpu(i)
+    {
+        wrr_rq = kzalloc_node(sizeof(struct wrr_rq),
+                              GFP_KERNEL, cpu_to_node(i));
+        if (!wrr_rq)
+            goto err;
+
+        wrr_se = kzalloc_node(sizeof(struct sched_wrr_entity),
+                              GFP_KERNEL, cpu_to_node(i));
+        if (!wrr_se)
+            goto err_free_rq;
+
+        init_wrr_rq(wrr_rq, cpu_rq(i));
+        init_tg_wrr_entry(tg, wrr_rq, wrr_se, i, parent->wrr_se[i]);
+    }
 
     return 1;
 
@@ -458,24 +609,105 @@ err:
     return 0;
 }
 
-// Dummy functions
-static int select_task_rq_wrr(struct task_struct *p, int sd_flag, int flags) {}
+#ifdef CONFIG_SMP
+/* Bandwidth runtime is only lent between online cpus */
+static void rq_offline_wrr(struct rq *rq)
+{
+    disable_wrr_runtime(rq);
+}
 
-static void set_cpus_allowed_wrr(struct task_struct *p, const struct cpumask *new_mask) {}
+static void rq_online_wrr(struct rq *rq)
+{
+    enable_wrr_runtime(rq);
+}
+
+/* This class balances on runnable tasks rather than on weight */
+static inline unsigned long wrr_cpu_load(int cpu)
+{
+    return ACCESS_ONCE(cpu_rq(cpu)->nr_running);
+}
+
+/*
+ * Place waking, forked and exec'ing tasks on the allowed cpu with the
+ * fewest runnable tasks, nearest first, see wrr_find_lightest_cpu().
+ * This is also how WRR tasks spread back over a cpu that came online after
+ * migrate_tasks() moved them off it.
+ */
+static int select_task_rq_wrr(struct task_struct *p, int sd_flag, int flags)
+{
+    int cpu = task_cpu(p);
+    int target;
+
+    if (p->rt.nr_cpus_allowed == 1)
+        return cpu;
 
-static void rq_offline_wrr(struct rq *rq) {}
+    /* For anything but wake ups, fork and exec, just return the task_cpu */
+    if (sd_flag != SD_BALANCE_WAKE && sd_flag != SD_BALANCE_FORK &&
+        sd_flag != SD_BALANCE_EXEC)
+        return cpu;
 
-static void rq_online_wrr(struct rq *rq) {}
+    if (cpumask_test_cpu(cpu, tsk_cpus_allowed(p)) && cpu_active(cpu) && idle_cpu(cpu))
+        return cpu;
 
+    target = wrr_find_lightest_cpu(p, cpu, wrr_cpu_load);
+    if (target != -1)
+        cpu = target;
+
+    return cpu;
+}
+
+/*
+ * This class keeps no per-cpu migration state to update. When @p may no
+ * longer run where it is queued, set_cpus_allowed_ptr() has the stopper
+ * move it, and select_task_rq_wrr() honours @new_mask from then on.
+ */
+static void set_cpus_allowed_wrr(struct task_struct *p, const struct cpumask *new_mask)
+{
+}
+
+// Dummy functions
 static void pre_schedule_wrr(struct rq *rq, struct task_struct *prev) {}
 
 static void post_schedule_wrr(struct rq *rq){}
 
 static void task_woken_wrr(struct rq *rq, struct task_struct *p) {}
 
+void trigger_wrr_load_balance(struct rq *rq, int cpu) {}
+
+void idle_pull_wrr_task(struct rq *this_rq) {}
+#endif /* CONFIG_SMP */
+
+__init void init_sched_wrr_class(void) {}
+
 static void switched_from_wrr(struct rq *rq, struct task_struct *p) {}
 
-static void prio_changed_wrr(struct rq *rq, struct task_struct *p, int oldprio) {}
+/*
+ * __sched_setscheduler() has requeued @p on its new level: give up the cpu
+ * if @p runs and an earlier level is queued now, else see if @p preempts.
+ */
+static void prio_changed_wrr(struct rq *rq, struct task_struct *p, int oldprio)
+{
+    struct sched_wrr_entity *wrr_se = &p->wrr;
+
+    if (!p->on_rq)
+        return;
+
+    if (rq->curr != p)
+    {
+        check_preempt_curr(rq, p, 0);
+        return;
+    }
+
+    for_each_sched_wrr_entity(wrr_se)
+    {
+        if (wrr_level_before(wrr_rq_of_se(wrr_se)->highest_prio.curr,
+                             wrr_se_prio(wrr_se)))
+        {
+            resched_task(p);
+            return;
+        }
+    }
+}
 
 const struct sched_class wrr_sched_class = {
     .next = &fair_sched_class,                    /*Required*/
@@ -487,12 +719,12 @@ const struct sched_class wrr_sched_class = {
     .pick_next_task = pick_next_task_wrr, /*Required*/
     .put_prev_task = put_prev_task_wrr,   /*Required*/
 
-    .task_fork = task_fork_wrr,
+    .task_fork = wrr_task_fork,
 #ifdef CONFIG_SMP
-    .select_task_rq = select_task_rq_wrr, /*Never need impl*/
+    .select_task_rq = select_task_rq_wrr,
     .set_cpus_allowed = set_cpus_allowed_wrr,
-    .rq_online = rq_online_wrr,         /*Never need impl*/
-    .rq_offline = rq_offline_wrr,       /*Never need impl*/
+    .rq_online = rq_online_wrr,
+    .rq_offline = rq_offline_wrr,
     .pre_schedule = pre_schedule_wrr,   /*Never need impl*/
     .post_schedule = post_schedule_wrr, /*Never need impl*/
     .task_woken = task_woken_wrr,       /*Never need impl*/
@@ -504,6 +736,6 @@ const struct sched_class wrr_sched_class = {
 
     .get_rr_interval = get_rr_interval_wrr,
 
-    .prio_changed = prio_changed_wrr, /*Never need impl*/
-    .switched_to = switched_to_wrr,   /*Never need impl*/
+    .prio_changed = prio_changed_wrr,
+    .switched_to = switched_to_wrr,
 };
@@ -1,10 +1,22 @@
 // This file is a driver program written to test three kinds of benchmarks
-// under a sequence of processes with different scheduling policies and 
-// print out basic informations.
+// under a sequence of processes with different scheduling policies. Every
+// configuration is run a number of times; each run is forked and exec'd
+// directly, timed with CLOCK_MONOTONIC and has its cpu time and context
+// switches taken from wait4(). The mean, standard deviation and 95%
+// confidence interval of every (benchmark, policy, process count) are
+// written out as CSV or JSON.
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
 
 #define SCHED_FIFO 1
 #define SCHED_RR 2
@@ -22,112 +34,414 @@
 #define mixed_max 80
 #define mixed_step 5
 
-FILE *fp;
-char command[1024];
-char sched[1024];
+#define DEFAULT_REPEATS 5
+#define MAX_REPEATS 1000
+#define MAX_ARGS 16
 
-void get_scheduler(int policy)
+// Marks the argument that takes the policy name, and the process count
+#define ARG_POLICY "%s"
+#define ARG_PROCS "%d"
+
+struct benchmark
 {
-    switch (policy)
-    {
-        case 1:
-            strcpy(sched, "SCHED_FIFO");
-            break;
-        case 2:
-            strcpy(sched, "SCHED_RR");
-            break;
-        case 3:
-            strcpy(sched, "SCHED_WRR");
-            break;
-    }
+    const char *name;
+    const char *binary;
+    int min, max, step;
+    const char *args[MAX_ARGS];
+};
+
+struct benchmark benchmarks[] = {
+    { "cpu", "test_cpubound", cpu_min, cpu_max, cpu_step,
+      { "100000", ARG_POLICY, ARG_PROCS, NULL } },
+    { "io", "test_iobound", io_min, io_max, io_step,
+      { ARG_POLICY, "/data/misc/data_in", "/data/misc/data_out", "2000", "5000000",
+        ARG_PROCS, NULL } },
+    { "mixed", "test_mixed", mixed_min, mixed_max, mixed_step,
+      { "100000", ARG_POLICY, ARG_PROCS, "2000", "5000000", "/data/misc/data_in",
+        "/data/misc/data_out2", NULL } },
+};
+
+#define NR_BENCHMARKS ((int)(sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+struct policy
+{
+    int policy;
+    const char *name;
+};
+
+struct policy policies[] = {
+    { SCHED_FIFO, "SCHED_FIFO" },
+    { SCHED_RR, "SCHED_RR" },
+    { SCHED_WRR, "SCHED_WRR" },
+};
+
+#define NR_POLICIES ((int)(sizeof(policies) / sizeof(policies[0])))
+
+// What one run took
+struct sample
+{
+    double wall;
+    double user;
+    double sys;
+    double nvcsw;
+    double nivcsw;
+};
+
+enum format
+{
+    FORMAT_CSV,
+    FORMAT_JSON,
+};
+
+int repeats = DEFAULT_REPEATS;
+int format = FORMAT_CSV;
+const char *bin_dir = ".";
+FILE *out;
+int nr_rows;
+
+void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-n repeats] [-f csv|json] [-o file] [-d dir] [-p policy]... "
+            "[-c min,max,step] [cpu|io|mixed]...\n"
+            "  -n  runs of every configuration (default %d)\n"
+            "  -f  output format (default csv)\n"
+            "  -o  write the results to file instead of stdout\n"
+            "  -d  directory of test_cpubound, test_iobound and test_mixed (default .)\n"
+            "  -p  SCHED_FIFO, SCHED_RR or SCHED_WRR, may be repeated (default all)\n"
+            "  -c  process counts to run (default each benchmark's own)\n",
+            prog, DEFAULT_REPEATS);
+    exit(1);
 }
 
-void CPUbound(int policy, FILE *fp)
-{ // to get the running time of test_cpubound
-    memset(sched, 0, sizeof(sched));
-    get_scheduler(policy);
+long long now_ns(void)
+{
+    struct timespec ts;
 
-    for(int i = cpu_min; i <= cpu_max; i += cpu_step)
-    {
-        memset(command, 0, sizeof(command));
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
 
-        printf("PROC_COUNT = %d\n", i);
-        sprintf(command, "time -p ./test_cpubound 100000 %s %d", sched, i);
-        fp = popen(command, "r");
-        pclose(fp);
-    }
+double tv_seconds(struct timeval tv)
+{
+    return tv.tv_sec + tv.tv_usec / 1e6;
 }
 
-void IObound(int policy, FILE *fp)
-{ // to get the running time of test_iobound
-    memset(sched, 0, sizeof(sched));
-    get_scheduler(policy);
+// Run the benchmark once and wait for it; returns 0 if it exited with 0
+int run_once(struct benchmark *b, struct policy *p, int procs, struct sample *s)
+{
+    char path[1024], count[16];
+    char *argv[MAX_ARGS + 2];
+    struct rusage ru;
+    long long start;
+    int i, pid, status, fd;
+
+    snprintf(path, sizeof(path), "%s/%s", bin_dir, b->binary);
+    snprintf(count, sizeof(count), "%d", procs);
 
-    for (int i = io_min; i <= io_max; i += io_step)
+    argv[0] = path;
+    for (i = 0; b->args[i]; i++)
     {
-    	memset(command, 0, sizeof(command));
+        if (!strcmp(b->args[i], ARG_POLICY))
+            argv[i + 1] = (char *)p->name;
+        else if (!strcmp(b->args[i], ARG_PROCS))
+            argv[i + 1] = count;
+        else
+            argv[i + 1] = (char *)b->args[i];
+    }
+    argv[i + 1] = NULL;
 
-    	printf("PROC_COUNT = %d\n", i);
-        sprintf(command, "time -p ./test_iobound %s /data/misc/data_in /data/misc/data_out 2000 5000000 %d", ret, i);
-        fp = popen(command, "r");
-        pclose(fp);
+    start = now_ns();
+    pid = fork();
+    if (pid == 0)
+    {
+        // Keep the benchmark's own output out of the results
+        fd = open("/dev/null", O_WRONLY);
+        if (fd >= 0)
+        {
+            dup2(fd, STDOUT_FILENO);
+            close(fd);
+        }
+        execv(path, argv);
+        fprintf(stderr, "Cannot run %s: %s\n", path, strerror(errno));
+        _exit(127);
+    }
+    else if (pid < 0)
+    {
+        fprintf(stderr, "Error forking.\n");
+        return -1;
     }
+
+    // The rusage of the benchmark includes all the children it waited for
+    if (wait4(pid, &status, 0, &ru) < 0)
+    {
+        fprintf(stderr, "Error waiting for %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    s->wall = (now_ns() - start) / 1e9;
+    s->user = tv_seconds(ru.ru_utime);
+    s->sys = tv_seconds(ru.ru_stime);
+    s->nvcsw = ru.ru_nvcsw;
+    s->nivcsw = ru.ru_nivcsw;
+
+    return WIFEXITED(status) && !WEXITSTATUS(status) ? 0 : -1;
+}
+
+// Two-sided 95% quantiles of Student's t distribution by degrees of freedom
+double t95(int df)
+{
+    static const double t[] = {
+        0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+
+    if (df < (int)(sizeof(t) / sizeof(t[0])))
+        return t[df];
+    return df < 60 ? 2.000 : df < 120 ? 1.980 : 1.960;
+}
+
+// Mean, sample standard deviation and 95% confidence half-width of n values
+void summarize(const double *x, int n, double *mean, double *sd, double *ci)
+{
+    double sum = 0, sq = 0;
+    int i;
+
+    for (i = 0; i < n; i++)
+        sum += x[i];
+    *mean = n ? sum / n : 0;
+
+    for (i = 0; i < n; i++)
+        sq += (x[i] - *mean) * (x[i] - *mean);
+    *sd = n > 1 ? sqrt(sq / (n - 1)) : 0;
+    *ci = n > 1 ? t95(n - 1) * *sd / sqrt(n) : 0;
+}
+
+void print_header(void)
+{
+    if (format == FORMAT_JSON)
+        fprintf(out, "[\n");
+    else
+        fprintf(out, "benchmark,policy,procs,runs,failed,"
+                     "wall_mean_s,wall_stddev_s,wall_ci95_s,wall_min_s,wall_max_s,"
+                     "user_mean_s,sys_mean_s,nvcsw_mean,nivcsw_mean\n");
+}
+
+void print_footer(void)
+{
+    if (format == FORMAT_JSON)
+        fprintf(out, "%s]\n", nr_rows ? "\n" : "");
 }
 
-void Mixed(int policy, FILE *fp)
-{ // to get the running time of test_mixed
-    memset(sched, 0, sizeof(sched));
-    get_scheduler(policy);
+void print_row(struct benchmark *b, struct policy *p, int procs,
+               struct sample *s, int runs, int failed)
+{
+    double wall[MAX_REPEATS], user[MAX_REPEATS], sys[MAX_REPEATS];
+    double nvcsw[MAX_REPEATS], nivcsw[MAX_REPEATS];
+    double mean, sd, ci, wmin = 0, wmax = 0, umean, smean, vmean, imean, dummy;
+    int i;
+
+    // No numbers at all rather than zeros when every run failed
+    if (!runs)
+    {
+        if (format == FORMAT_JSON)
+            fprintf(out, "%s  {\"benchmark\": \"%s\", \"policy\": \"%s\", \"procs\": %d, "
+                         "\"runs\": 0, \"failed\": %d}",
+                    nr_rows ? ",\n" : "", b->name, p->name, procs, failed);
+        else
+            fprintf(out, "%s,%s,%d,0,%d,,,,,,,,,\n", b->name, p->name, procs, failed);
+
+        fflush(out);
+        nr_rows++;
+        return;
+    }
 
-    for (int i = mixed_min; i <= mixed_max; i += mixed_step)
+    for (i = 0; i < runs; i++)
     {
-    	memset(command, 0, sizeof(command));
+        wall[i] = s[i].wall;
+        user[i] = s[i].user;
+        sys[i] = s[i].sys;
+        nvcsw[i] = s[i].nvcsw;
+        nivcsw[i] = s[i].nivcsw;
+        if (!i || wall[i] < wmin)
+            wmin = wall[i];
+        if (!i || wall[i] > wmax)
+            wmax = wall[i];
+    }
+
+    summarize(wall, runs, &mean, &sd, &ci);
+    summarize(user, runs, &umean, &dummy, &dummy);
+    summarize(sys, runs, &smean, &dummy, &dummy);
+    summarize(nvcsw, runs, &vmean, &dummy, &dummy);
+    summarize(nivcsw, runs, &imean, &dummy, &dummy);
 
-    	printf("PROC_COUNT = %d\n", i);
-        sprintf(command, "time -p ./test_mixed 100000 %s %d 2000 5000000 /data/misc/data_in /data/misc/data_out2", ret, i);
-        fp = popen(command, "r");
-        pclose(fp);
+    if (format == FORMAT_JSON)
+    {
+        fprintf(out, "%s  {\"benchmark\": \"%s\", \"policy\": \"%s\", \"procs\": %d, "
+                     "\"runs\": %d, \"failed\": %d, "
+                     "\"wall_mean_s\": %.6f, \"wall_stddev_s\": %.6f, \"wall_ci95_s\": %.6f, "
+                     "\"wall_min_s\": %.6f, \"wall_max_s\": %.6f, "
+                     "\"user_mean_s\": %.6f, \"sys_mean_s\": %.6f, "
+                     "\"nvcsw_mean\": %.1f, \"nivcsw_mean\": %.1f}",
+                nr_rows ? ",\n" : "", b->name, p->name, procs, runs, failed,
+                mean, sd, ci, wmin, wmax, umean, smean, vmean, imean);
+    }
+    else
+    {
+        fprintf(out, "%s,%s,%d,%d,%d,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.1f,%.1f\n",
+                b->name, p->name, procs, runs, failed,
+                mean, sd, ci, wmin, wmax, umean, smean, vmean, imean);
     }
+
+    fflush(out);
+    nr_rows++;
 }
 
-void cpu_res()
+// Run every process count of one benchmark under one policy
+void run_benchmark(struct benchmark *b, struct policy *p)
 {
-    printf("The CPU Bound Results!\n");
-    printf("SCHED_FIFO:\n");
-    CPUbound(SCHED_FIFO, fp);
-    printf("SCHED_RR:\n");
-    CPUbound(SCHED_RR, fp);
-    printf("SCHED_WRR:\n");
-    CPUbound(SCHED_WRR, fp);
+    struct sample s[MAX_REPEATS];
+    int procs, runs, failed, i;
+
+    for (procs = b->min; procs <= b->max; procs += b->step)
+    {
+        fprintf(stderr, "%s %s PROC_COUNT = %d\n", b->name, p->name, procs);
+
+        runs = failed = 0;
+        for (i = 0; i < repeats; i++)
+        {
+            if (run_once(b, p, procs, &s[runs]))
+                failed++;
+            else
+                runs++;
+        }
+
+        print_row(b, p, procs, s, runs, failed);
+    }
 }
 
-void io_res()
+struct policy *find_policy(const char *name)
 {
-    printf("The IO Bound Results!\n");
-	printf("SCHED_FIFO:\n");
-    IObound(SCHED_FIFO, fp);
-    printf("SCHED_RR:\n");
-    IObound(SCHED_RR, fp);
-    printf("SCHED_WRR:\n");
-    IObound(SCHED_WRR, fp);
+    int i;
+
+    for (i = 0; i < NR_POLICIES; i++)
+    {
+        if (!strcmp(policies[i].name, name))
+            return &policies[i];
+    }
+
+    return NULL;
 }
 
-void mixed_res()
+struct benchmark *find_benchmark(const char *name)
 {
-    printf("The Mixed Results!\n");
-	printf("SCHED_FIFO:\n");
-    Mixed(SCHED_FIFO, fp);
-    printf("SCHED_RR:\n");
-    Mixed(SCHED_RR, fp);
-    printf("SCHED_WRR:\n");
-    Mixed(SCHED_WRR, fp);
+    int i;
+
+    for (i = 0; i < NR_BENCHMARKS; i++)
+    {
+        if (!strcmp(benchmarks[i].name, name))
+            return &benchmarks[i];
+    }
+
+    return NULL;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
-        cpu_res();
+    struct policy *use_policies[NR_POLICIES];
+    struct benchmark *b;
+    int nr_policies = 0, min = 0, max = 0, step = 0;
+    int opt, i, j, ran = 0;
+
+    out = stdout;
+
+    while ((opt = getopt(argc, argv, "n:f:o:d:p:c:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                repeats = atoi(optarg);
+                if (repeats < 1 || repeats > MAX_REPEATS)
+                {
+                    fprintf(stderr, "Repeats out of range!\n");
+                    exit(1);
+                }
+                break;
+            case 'f':
+                if (!strcmp(optarg, "csv"))
+                    format = FORMAT_CSV;
+                else if (!strcmp(optarg, "json"))
+                    format = FORMAT_JSON;
+                else
+                    usage(argv[0]);
+                break;
+            case 'o':
+                out = fopen(optarg, "w");
+                if (!out)
+                {
+                    fprintf(stderr, "Cannot open %s: %s\n", optarg, strerror(errno));
+                    exit(1);
+                }
+                break;
+            case 'd':
+                bin_dir = optarg;
+                break;
+            case 'p':
+                if (nr_policies == NR_POLICIES || !find_policy(optarg))
+                    usage(argv[0]);
+                use_policies[nr_policies++] = find_policy(optarg);
+                break;
+            case 'c':
+                if (sscanf(optarg, "%d,%d,%d", &min, &max, &step) != 3 ||
+                    min < 1 || max < min || step < 1)
+                    usage(argv[0]);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (!nr_policies)
+    {
+        for (i = 0; i < NR_POLICIES; i++)
+            use_policies[nr_policies++] = &policies[i];
+    }
+
+    for (i = optind; i < argc; i++)
+    {
+        if (!find_benchmark(argv[i]))
+            usage(argv[0]);
+    }
+
+    print_header();
+
+    for (i = 0; i < NR_BENCHMARKS; i++)
+    {
+        b = &benchmarks[i];
+
+        // Only the benchmarks named on the command line, if any
+        for (j = optind; j < argc && strcmp(argv[j], b->name); j++)
+            ;
+        if (optind < argc && j == argc)
+            continue;
 
-        io_res();
+        if (step)
+        {
+            b->min = min;
+            b->max = max;
+            b->step = step;
+        }
 
-        mixed_res();
-}
\ No newline at end of file
+        for (j = 0; j < nr_policies; j++)
+            run_benchmark(b, use_policies[j]);
+        ran++;
+    }
+
+    print_footer();
+
+    if (out != stdout)
+        fclose(out);
+
+    return ran ? 0 : 1;
+}
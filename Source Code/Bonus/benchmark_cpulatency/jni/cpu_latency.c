@@ -1,14 +1,20 @@
-// This file is a CPU-bound benchmark which forks a number of 
-// child processes with different priorities and measure their latencies
+// This file is a CPU-bound latency benchmark. It forks a number of child
+// processes with different priorities that each, round after round, block
+// on a pipe, get woken by the parent and burn cpu. The parent stamps the
+// CLOCK_MONOTONIC time of every wakeup into shared memory just before it
+// writes the pipe, and the child takes its wakeup-to-run latency as soon
+// as its read() returns. All latencies go into one log-linear histogram,
+// HDR style, from which the percentiles of the policy are reported.
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
 #include <sched.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/wait.h>
-#include <sys/time.h>
 
 #define SCHED_FIFO 1
 #define SCHED_RR 2
@@ -16,7 +22,36 @@
 
 #define DEFAULT_ITERATIONS 100000
 #define DEFAULT_CHILDREN 20
+#define DEFAULT_ROUNDS 100
 #define MAX_CHILDREN 500
+#define MAX_ROUNDS 100000
+
+// Time the parent gives every child to get back into read() between rounds
+#define SETTLE_US 1000
+
+/*
+ * Log-linear histogram: values below 2^SUB_BITS ns have a bucket each, and
+ * every power of two above that is split into 2^SUB_BITS buckets, so any
+ * value is off by less than 1/2^SUB_BITS of itself.
+ */
+#define SUB_BITS 7
+#define SUB_COUNT (1 << SUB_BITS)
+#define MAX_SHIFT 40
+#define NR_BUCKETS ((MAX_SHIFT + 1) * SUB_COUNT)
+
+struct histogram
+{
+    unsigned long long count[NR_BUCKETS];
+    unsigned long long total;
+    long long max;
+};
+
+// Shared between the parent and all children
+struct shared
+{
+    struct histogram hist;
+    long long wake_ns[MAX_CHILDREN];
+};
 
 double inline Rand(double L, double R)
 {
@@ -46,12 +81,90 @@ double calcE(int iterations)
     return pow(2.0, 1.0 * n / m);
 }
 
-// Parse commadline arguments to get iterations, policy and process number
-void parser(int argc, char *argv[], int *iterations, int *policy, int *child_count)
+long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int msb(unsigned long long v)
+{
+    int bit = 0;
+
+    while (v >>= 1)
+        bit++;
+    return bit;
+}
+
+int bucket_of(long long ns)
+{
+    unsigned long long v = ns < 0 ? 0 : ns;
+    int shift;
+
+    if (v < SUB_COUNT)
+        return v;
+
+    shift = msb(v) - SUB_BITS;
+    if (shift >= MAX_SHIFT)
+        return NR_BUCKETS - 1;
+
+    return (shift + 1) * SUB_COUNT + (int)((v >> shift) - SUB_COUNT);
+}
+
+// The highest value that falls into bucket b
+long long bucket_top(int b)
 {
-    if (argc != 4)
+    int shift = b / SUB_COUNT - 1;
+
+    if (shift < 0)
+        return b;
+
+    return ((long long)(SUB_COUNT + b % SUB_COUNT + 1) << shift) - 1;
+}
+
+// Called by the children at once, so every update is atomic
+void hist_add(struct histogram *h, long long ns)
+{
+    long long max;
+
+    __sync_fetch_and_add(&h->count[bucket_of(ns)], 1);
+    __sync_fetch_and_add(&h->total, 1);
+
+    max = h->max;
+    while (ns > max && !__sync_bool_compare_and_swap(&h->max, max, ns))
+        max = h->max;
+}
+
+// The value at percentile pct, at most the max seen
+long long hist_percentile(struct histogram *h, double pct)
+{
+    unsigned long long seen = 0, rank;
+    int b;
+
+    rank = (unsigned long long)ceil(pct / 100.0 * h->total);
+    if (!rank)
+        rank = 1;
+
+    for (b = 0; b < NR_BUCKETS; b++)
+    {
+        seen += h->count[b];
+        if (seen >= rank)
+            return bucket_top(b) < h->max ? bucket_top(b) : h->max;
+    }
+
+    return h->max;
+}
+
+// Parse commadline arguments to get iterations, policy, process number and rounds
+void parser(int argc, char *argv[], int *iterations, int *policy, int *child_count,
+            int *rounds)
+{
+    if (argc != 4 && argc != 5)
     {
-        fprintf(stderr, "Input format error!\n");
+        fprintf(stderr, "Usage: %s <iterations> <SCHED_WRR|SCHED_FIFO|SCHED_RR> "
+                        "<children> [rounds]\n", argv[0]);
         exit(1);
     }
 
@@ -89,22 +202,72 @@ void parser(int argc, char *argv[], int *iterations, int *policy, int *child_cou
         fprintf(stderr, "Children number error!\n");
         exit(1);
     }
+
+    // Set rounds of wakeups
+    *rounds = argc == 5 ? atoi(argv[4]) : DEFAULT_ROUNDS;
+    if (*rounds < 1 || *rounds > MAX_ROUNDS)
+    {
+        fprintf(stderr, "Rounds out of range!\n");
+        exit(1);
+    }
 }
 
-int main(int argc, char *argv[])
+// A child: every round, sleep in read() until woken, take the latency, work
+void child_task(struct shared *sh, int id, int wake_fd, int done_fd,
+                int iterations, int rounds)
 {
+    char c;
     int i;
+
+    for (i = 0; i < rounds; i++)
+    {
+        if (read(wake_fd, &c, 1) != 1)
+            exit(1);
+        hist_add(&sh->hist, now_ns() - sh->wake_ns[id]);
+
+        calcE(iterations);
+
+        if (write(done_fd, &c, 1) != 1)
+            exit(1);
+    }
+
+    exit(0);
+}
+
+int main(int argc, char *argv[])
+{
+    int i, r;
     int pid;
     int iterations;
     struct sched_param param;
     int policy;
     int child_count;
-    struct timeval now;
+    int rounds;
+    int done[2];
+    struct shared *sh;
+    char c = 0;
 
     // Parse command line
-    parser(argc, argv, &iterations, &policy, &child_count);
+    parser(argc, argv, &iterations, &policy, &child_count, &rounds);
 
-    // Set process to max priority for given scheduler
+    sh = mmap(NULL, sizeof(*sh), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (sh == MAP_FAILED)
+    {
+        fprintf(stderr, "Error mapping shared memory.\n");
+        exit(1);
+    }
+    memset(sh, 0, sizeof(*sh));
+
+    if (pipe(done))
+    {
+        fprintf(stderr, "Error creating pipes.\n");
+        exit(1);
+    }
+
+    // Set process to max priority for given scheduler. Under SCHED_WRR,
+    // as under SCHED_FIFO and SCHED_RR, the highest priority runs first and
+    // the children stay below it, so it wakes them on time. SCHED_NORMAL
+    // has no priorities and the driver competes with the children there.
     param.sched_priority = sched_get_priority_max(policy);
 
     // Set new scheduler policy
@@ -116,29 +279,33 @@ int main(int argc, char *argv[])
 
     // Start forking children
     int *children = malloc(sizeof(int) * child_count);
+    int *wake = malloc(sizeof(int) * child_count);
     for (i = 0; i < child_count; i++)
     {
-        gettimeofday(&now,NULL); // get time before fork
+        int fds[2];
+
+        if (pipe(fds))
+        {
+            fprintf(stderr, "Error creating pipes.\n");
+            exit(1);
+        }
+
         pid = fork();
         if (pid > 0)
         {
-            children[i] = pid; 
-            // get random priority
-            param.sched_priority = rand() % 100;
+            close(fds[0]);
+            children[i] = pid;
+            wake[i] = fds[1];
+            // get random priority, 1-98 so that none ties the driver
+            param.sched_priority = 1 + rand() % 98;
             // set child priority
             sched_setscheduler(pid, policy, &param);
         }
         else if (pid == 0)
         {
-            struct timeval start;
-            gettimeofday(&start,NULL); // get current time
-            long int latency = (start.tv_usec - now.tv_usec) + (start.tv_sec - now.tv_sec)*1e6;
-            pid_t chdId = getpid();
-            
-            // print out each child process' latency
-            printf("PID: [%d], latency: [%ld]\n", chdId, latency);
-            calcE(iterations);
-            exit(0);
+            close(fds[1]);
+            close(done[0]);
+            child_task(sh, i, fds[0], done[1], iterations, rounds);
         }
         else if (pid < 0)
         {
@@ -146,12 +313,48 @@ int main(int argc, char *argv[])
             exit(1);
         }
     }
+    close(done[1]);
+
+    // Wake every child once a round, and wait for all of them to finish it
+    for (r = 0; r < rounds; r++)
+    {
+        usleep(SETTLE_US);
+
+        for (i = 0; i < child_count; i++)
+        {
+            sh->wake_ns[i] = now_ns();
+            if (write(wake[i], &c, 1) != 1)
+            {
+                fprintf(stderr, "Pipe error.\n");
+                exit(1);
+            }
+        }
+
+        for (i = 0; i < child_count; i++)
+        {
+            if (read(done[0], &c, 1) != 1)
+            {
+                fprintf(stderr, "A child died.\n");
+                exit(1);
+            }
+        }
+    }
 
     for (i = 0; i < child_count; i++)
     {
         waitpid(children[i], NULL, 0);
     }
     free(children);
+    free(wake);
+
+    printf("%s: %d children, %d rounds, %llu wakeups\n",
+           argv[2], child_count, rounds, sh->hist.total);
+    printf("latency (us): p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+           hist_percentile(&sh->hist, 50) / 1e3,
+           hist_percentile(&sh->hist, 90) / 1e3,
+           hist_percentile(&sh->hist, 99) / 1e3,
+           hist_percentile(&sh->hist, 99.9) / 1e3,
+           sh->hist.max / 1e3);
 
     return 0;
-}
\ No newline at end of file
+}
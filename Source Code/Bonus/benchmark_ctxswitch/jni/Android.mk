@@ -0,0 +1,8 @@
+LOCAL_PATH := $(call my-dir)
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES := ctx_switch.c # your source code
+LOCAL_MODULE := test_ctxswitch # output file name
+LOCAL_CFLAGS += -pie -fPIE # These two line mustn’t be
+LOCAL_LDFLAGS += -pie -fPIE # change.
+LOCAL_FORCE_STATIC_EXECUTABLE := true
+include $(BUILD_EXECUTABLE)
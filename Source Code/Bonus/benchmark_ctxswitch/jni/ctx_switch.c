@@ -0,0 +1,147 @@
+// This file is a context-switch benchmark: two processes pinned to the
+// same CPU pass a byte back and forth through a pair of pipes, so every
+// round trip costs two wakeups and two switches through the scheduler.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define SCHED_FIFO 1
+#define SCHED_RR 2
+#define SCHED_WRR 6
+
+// Parse commandline arguments to get round trips, policy and cpu
+void parser(int argc, char *argv[], int *rounds, int *policy, int *cpu)
+{
+    if (argc != 4)
+    {
+        fprintf(stderr, "Usage: %s <round trips> <SCHED_WRR|SCHED_FIFO|SCHED_RR> <cpu>\n", argv[0]);
+        exit(1);
+    }
+
+    // Set round trips
+    *rounds = atoi(argv[1]);
+    if (*rounds < 1)
+    {
+        fprintf(stderr, "Round trips out of range!\n");
+        exit(1);
+    }
+
+    // Set policy
+    if (!strcmp(argv[2], "SCHED_WRR"))
+    {
+        *policy = SCHED_WRR;
+    }
+    else if (!strcmp(argv[2], "SCHED_FIFO"))
+    {
+        *policy = SCHED_FIFO;
+    }
+    else if (!strcmp(argv[2], "SCHED_RR"))
+    {
+        *policy = SCHED_RR;
+    }
+    else
+    {
+        fprintf(stderr, "Undefined scheduling policy!\n");
+        exit(1);
+    }
+
+    // Set cpu both processes run on
+    *cpu = atoi(argv[3]);
+    if (*cpu < 0 || *cpu >= CPU_SETSIZE)
+    {
+        fprintf(stderr, "CPU out of range!\n");
+        exit(1);
+    }
+}
+
+// Pin the caller to one cpu and switch it to the given policy
+void setup(int policy, int cpu)
+{
+    struct sched_param param;
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set))
+    {
+        fprintf(stderr, "Setting affinity error!\n");
+        exit(1);
+    }
+
+    param.sched_priority = sched_get_priority_max(policy);
+    if (sched_setscheduler(0, policy, &param))
+    {
+        fprintf(stderr, "Setting scheduler error!\n");
+        exit(1);
+    }
+}
+
+long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    int rounds, policy, cpu;
+    int ping[2], pong[2];
+    long long start, elapsed;
+    char c = 0;
+    int i, pid;
+
+    // Parse command line
+    parser(argc, argv, &rounds, &policy, &cpu);
+
+    if (pipe(ping) || pipe(pong))
+    {
+        fprintf(stderr, "Error creating pipes.\n");
+        exit(1);
+    }
+
+    setup(policy, cpu);
+
+    pid = fork();
+    if (pid == 0)
+    {
+        // The child echoes every byte it gets
+        for (i = 0; i < rounds; i++)
+        {
+            if (read(ping[0], &c, 1) != 1 || write(pong[1], &c, 1) != 1)
+                exit(1);
+        }
+        exit(0);
+    }
+    else if (pid < 0)
+    {
+        fprintf(stderr, "Error forking.\n");
+        exit(1);
+    }
+
+    start = now_ns();
+    for (i = 0; i < rounds; i++)
+    {
+        if (write(ping[1], &c, 1) != 1 || read(pong[0], &c, 1) != 1)
+        {
+            fprintf(stderr, "Pipe error.\n");
+            exit(1);
+        }
+    }
+    elapsed = now_ns() - start;
+
+    waitpid(pid, NULL, 0);
+
+    // Every round trip is two context switches
+    printf("%s: %d round trips in %lld us, %.1f ns per switch\n",
+           argv[2], rounds, elapsed / 1000, (double)elapsed / (2.0 * rounds));
+
+    return 0;
+}
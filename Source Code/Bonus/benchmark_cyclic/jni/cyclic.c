@@ -0,0 +1,546 @@
+// This file is a cyclictest-style periodic wakeup benchmark. A number of
+// threads, alternately in the foreground and the background cgroup, sleep
+// on clock_nanosleep(TIMER_ABSTIME) until the next tick of their own
+// interval while CPU hogs in both groups keep every cpu busy. Each wakeup
+// records how far past its tick the thread ran; the overshoots are kept
+// in a log-linear histogram per thread and summed per group.
+//
+// Besides the Android.mk, it builds on a Linux host with
+//     gcc -O2 -pthread -o cyclic cyclic.c
+// where SCHED_WRR falls back to SCHED_RR, then to SCHED_OTHER.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#define SCHED_OTHER 0
+#define SCHED_FIFO 1
+#define SCHED_RR 2
+#define SCHED_WRR 6
+
+#define DEFAULT_THREADS 4
+#define DEFAULT_INTERVAL_US 1000
+#define DEFAULT_DISTANCE_US 500
+#define DEFAULT_DURATION 10
+#define DEFAULT_PRIORITY 50
+#define DEFAULT_CGROUP_DIR "/dev/cpuctl"
+#define MAX_THREADS 64
+#define MAX_HOGS 64
+
+/*
+ * Log-linear histogram: values below 2^SUB_BITS ns have a bucket each, and
+ * every power of two above that is split into 2^SUB_BITS buckets, so any
+ * value is off by less than 1/2^SUB_BITS of itself.
+ */
+#define SUB_BITS 7
+#define SUB_COUNT (1 << SUB_BITS)
+#define MAX_SHIFT 40
+#define NR_BUCKETS ((MAX_SHIFT + 1) * SUB_COUNT)
+
+enum
+{
+    GROUP_FORE,
+    GROUP_BACK,
+    NR_GROUPS,
+};
+
+const char *group_names[NR_GROUPS] = { "fore", "back" };
+
+// The cgroup below the cpu controller mount that every group lives in
+const char *group_dirs[NR_GROUPS] = { "", "/bg_non_interactive" };
+
+struct histogram
+{
+    unsigned long long count[NR_BUCKETS];
+    unsigned long long total;
+    long long max;
+};
+
+struct thread
+{
+    pthread_t id;
+    int index;
+    int group;
+    int joined;             // whether it got into the cgroup of its group
+    long long interval_ns;
+    struct histogram hist;
+};
+
+int nr_threads = DEFAULT_THREADS;
+int nr_hogs = -1;
+int interval_us = DEFAULT_INTERVAL_US;
+int distance_us = DEFAULT_DISTANCE_US;
+int duration = DEFAULT_DURATION;
+int policy = SCHED_WRR;
+int priority = DEFAULT_PRIORITY;
+const char *cgroup_dir = DEFAULT_CGROUP_DIR;
+
+// Whether the tasks file of each group could be written
+int group_usable[NR_GROUPS];
+
+// Hogs that could not get into the cgroup of their group
+int hogs_unjoined;
+
+// Threads and hogs that have taken their group and policy
+volatile int nr_ready;
+
+volatile int stop;
+
+void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-t threads] [-H hogs] [-i interval] [-d distance] [-D seconds] "
+            "[-p policy] [-P priority] [-c dir]\n"
+            "  -t  measured threads, alternately fore and back (default %d)\n"
+            "  -H  cpu hogs, alternately fore and back (default one per cpu)\n"
+            "  -i  interval of the first thread in us (default %d)\n"
+            "  -d  interval added for every further thread in us (default %d)\n"
+            "  -D  run time in seconds (default %d)\n"
+            "  -p  SCHED_WRR, SCHED_FIFO or SCHED_RR (default SCHED_WRR)\n"
+            "  -P  rt_priority of the threads and hogs (default %d)\n"
+            "  -c  mount point of the cpu cgroup controller (default %s)\n",
+            prog, DEFAULT_THREADS, DEFAULT_INTERVAL_US, DEFAULT_DISTANCE_US,
+            DEFAULT_DURATION, DEFAULT_PRIORITY, DEFAULT_CGROUP_DIR);
+    exit(1);
+}
+
+const char *policy_name(int policy)
+{
+    switch (policy)
+    {
+        case SCHED_WRR:
+            return "SCHED_WRR";
+        case SCHED_FIFO:
+            return "SCHED_FIFO";
+        case SCHED_RR:
+            return "SCHED_RR";
+        default:
+            return "SCHED_OTHER";
+    }
+}
+
+long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int msb(unsigned long long v)
+{
+    int bit = 0;
+
+    while (v >>= 1)
+        bit++;
+    return bit;
+}
+
+int bucket_of(long long ns)
+{
+    unsigned long long v = ns < 0 ? 0 : ns;
+    int shift;
+
+    if (v < SUB_COUNT)
+        return v;
+
+    shift = msb(v) - SUB_BITS;
+    if (shift >= MAX_SHIFT)
+        return NR_BUCKETS - 1;
+
+    return (shift + 1) * SUB_COUNT + (int)((v >> shift) - SUB_COUNT);
+}
+
+// The highest value that falls into bucket b
+long long bucket_top(int b)
+{
+    int shift = b / SUB_COUNT - 1;
+
+    if (shift < 0)
+        return b;
+
+    return ((long long)(SUB_COUNT + b % SUB_COUNT + 1) << shift) - 1;
+}
+
+void hist_add(struct histogram *h, long long ns)
+{
+    h->count[bucket_of(ns)]++;
+    h->total++;
+    if (ns > h->max)
+        h->max = ns;
+}
+
+void hist_merge(struct histogram *h, struct histogram *from)
+{
+    int b;
+
+    for (b = 0; b < NR_BUCKETS; b++)
+        h->count[b] += from->count[b];
+    h->total += from->total;
+    if (from->max > h->max)
+        h->max = from->max;
+}
+
+// The value at permille of the samples, at most the max seen
+long long hist_permille(struct histogram *h, int permille)
+{
+    unsigned long long seen = 0, rank;
+    int b;
+
+    rank = (h->total * permille + 999) / 1000;
+    if (!rank)
+        rank = 1;
+
+    for (b = 0; b < NR_BUCKETS; b++)
+    {
+        seen += h->count[b];
+        if (seen >= rank)
+            return bucket_top(b) < h->max ? bucket_top(b) : h->max;
+    }
+
+    return h->max;
+}
+
+void group_path(char *path, size_t size, int group)
+{
+    snprintf(path, size, "%s%s/tasks", cgroup_dir, group_dirs[group]);
+}
+
+// Move the calling thread, not its whole process, into the cgroup of group
+int join_group(int group)
+{
+    char path[256], tid[16];
+    int fd, len, ret = 0;
+
+    if (!group_usable[group])
+        return -1;
+
+    group_path(path, sizeof(path), group);
+    fd = open(path, O_WRONLY);
+    if (fd < 0)
+        return -1;
+
+    len = snprintf(tid, sizeof(tid), "%ld", (long)syscall(SYS_gettid));
+    if (write(fd, tid, len) != len)
+        ret = -1;
+    close(fd);
+
+    return ret;
+}
+
+// Set the policy of the calling thread
+int set_policy(int policy, int priority)
+{
+    struct sched_param param;
+
+    param.sched_priority = policy == SCHED_OTHER ? 0 : priority;
+    return sched_setscheduler(0, policy, &param);
+}
+
+/*
+ * Every thread starts with the policy of the main thread, and the kernel
+ * refuses to move rt tasks into a cgroup without rt runtime. So a thread
+ * drops back to SCHED_OTHER, joins its cgroup and only then takes the
+ * policy of the run. Not done with PTHREAD_EXPLICIT_SCHED, which older
+ * bionic does not have.
+ */
+int enter_group(int group, int priority)
+{
+    int joined;
+
+    set_policy(SCHED_OTHER, 0);
+    joined = !join_group(group);
+    if (set_policy(policy, priority))
+        fprintf(stderr, "Warning: a %s thread cannot set %s\n", group_names[group],
+                policy_name(policy));
+
+    // A hog that spins before every thread is done here would starve the
+    // ones still at SCHED_OTHER; sleep so that they can finish
+    __sync_fetch_and_add(&nr_ready, 1);
+    while (nr_ready < nr_threads + nr_hogs)
+        usleep(1000);
+
+    return joined;
+}
+
+// Hogs under SCHED_FIFO sit one level below the threads, or a hog would
+// never give its cpu back to a thread of the same priority
+int hog_priority(void)
+{
+    if (policy == SCHED_FIFO && priority > 1)
+        return priority - 1;
+    return priority;
+}
+
+void *hog(void *arg)
+{
+    long group = (long)arg;
+    volatile unsigned long spin = 0;
+
+    if (!enter_group(group, hog_priority()))
+        __sync_fetch_and_add(&hogs_unjoined, 1);
+
+    while (!stop)
+        spin++;
+
+    return NULL;
+}
+
+void *measure(void *arg)
+{
+    struct thread *t = arg;
+    struct timespec next;
+    long long tick;
+
+    t->joined = enter_group(t->group, priority);
+
+    tick = now_ns();
+    while (!stop)
+    {
+        tick += t->interval_ns;
+        next.tv_sec = tick / 1000000000LL;
+        next.tv_nsec = tick % 1000000000LL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL))
+            ;
+
+        hist_add(&t->hist, now_ns() - tick);
+    }
+
+    return NULL;
+}
+
+// Find the policy this kernel lets us use, trying the requested one first
+void probe_policy(void)
+{
+    if (!set_policy(policy, priority))
+        return;
+
+    if (policy == SCHED_WRR)
+    {
+        fprintf(stderr, "Warning: SCHED_WRR is not available, falling back to SCHED_RR\n");
+        policy = SCHED_RR;
+        if (!set_policy(policy, priority))
+            return;
+    }
+
+    fprintf(stderr, "Warning: %s is not permitted, falling back to SCHED_OTHER\n",
+            policy_name(policy));
+    policy = SCHED_OTHER;
+    set_policy(policy, 0);
+}
+
+void probe_groups(void)
+{
+    char path[256];
+    int g;
+
+    for (g = 0; g < NR_GROUPS; g++)
+    {
+        group_path(path, sizeof(path), g);
+        group_usable[g] = !access(path, W_OK);
+        if (!group_usable[g])
+            fprintf(stderr, "Warning: cannot write %s, %s threads stay in their "
+                            "current cgroup\n", path, group_names[g]);
+    }
+}
+
+void print_row(const char *name, const char *group, const char *interval,
+               struct histogram *h)
+{
+    printf("%-8s %-6s %9s %9llu %8.1f %8.1f %8.1f %8.1f %8.1f\n",
+           name, group, interval, h->total,
+           hist_permille(h, 500) / 1e3, hist_permille(h, 900) / 1e3,
+           hist_permille(h, 990) / 1e3, hist_permille(h, 999) / 1e3,
+           h->max / 1e3);
+}
+
+int main(int argc, char *argv[])
+{
+    struct thread *threads;
+    struct histogram *groups;
+    pthread_t hogs[MAX_HOGS];
+    struct timespec left;
+    char name[16], interval[16], group[16];
+    int opt, i, unjoined = 0;
+
+    while ((opt = getopt(argc, argv, "t:H:i:d:D:p:P:c:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 't':
+                nr_threads = atoi(optarg);
+                if (nr_threads < 1 || nr_threads > MAX_THREADS)
+                {
+                    fprintf(stderr, "Threads number error!\n");
+                    exit(1);
+                }
+                break;
+            case 'H':
+                nr_hogs = atoi(optarg);
+                if (nr_hogs < 0 || nr_hogs > MAX_HOGS)
+                {
+                    fprintf(stderr, "Hogs number error!\n");
+                    exit(1);
+                }
+                break;
+            case 'i':
+                interval_us = atoi(optarg);
+                if (interval_us < 1)
+                {
+                    fprintf(stderr, "Interval out of range!\n");
+                    exit(1);
+                }
+                break;
+            case 'd':
+                distance_us = atoi(optarg);
+                if (distance_us < 0)
+                {
+                    fprintf(stderr, "Distance out of range!\n");
+                    exit(1);
+                }
+                break;
+            case 'D':
+                duration = atoi(optarg);
+                if (duration < 1)
+                {
+                    fprintf(stderr, "Duration out of range!\n");
+                    exit(1);
+                }
+                break;
+            case 'p':
+                if (!strcmp(optarg, "SCHED_WRR"))
+                {
+                    policy = SCHED_WRR;
+                }
+                else if (!strcmp(optarg, "SCHED_FIFO"))
+                {
+                    policy = SCHED_FIFO;
+                }
+                else if (!strcmp(optarg, "SCHED_RR"))
+                {
+                    policy = SCHED_RR;
+                }
+                else
+                {
+                    fprintf(stderr, "Undefined scheduling policy!\n");
+                    exit(1);
+                }
+                break;
+            case 'P':
+                priority = atoi(optarg);
+                if (priority < 1 || priority > 99)
+                {
+                    fprintf(stderr, "Priority out of range!\n");
+                    exit(1);
+                }
+                break;
+            case 'c':
+                cgroup_dir = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind != argc)
+        usage(argv[0]);
+
+    if (nr_hogs < 0)
+    {
+        nr_hogs = sysconf(_SC_NPROCESSORS_ONLN);
+        if (nr_hogs < 1)
+            nr_hogs = 1;
+        if (nr_hogs > MAX_HOGS)
+            nr_hogs = MAX_HOGS;
+    }
+
+    // Page faults would show up as overshoots
+    mlockall(MCL_CURRENT | MCL_FUTURE);
+
+    // The main thread only sleeps, but takes the policy first so that the
+    // fallback is decided once for every thread, and keeps it so that the
+    // hogs cannot keep it from ending the run
+    probe_policy();
+    probe_groups();
+
+    threads = calloc(nr_threads, sizeof(*threads));
+    groups = calloc(NR_GROUPS, sizeof(*groups));
+    if (!threads || !groups)
+    {
+        fprintf(stderr, "Out of memory.\n");
+        exit(1);
+    }
+
+    // Start the hogs first so that the cpus are busy from the first tick
+    for (i = 0; i < nr_hogs; i++)
+    {
+        if (pthread_create(&hogs[i], NULL, hog, (void *)(long)(i % NR_GROUPS)))
+        {
+            fprintf(stderr, "Error creating threads.\n");
+            exit(1);
+        }
+    }
+
+    for (i = 0; i < nr_threads; i++)
+    {
+        threads[i].index = i;
+        threads[i].group = i % NR_GROUPS;
+        threads[i].interval_ns = (interval_us + (long long)i * distance_us) * 1000;
+        if (pthread_create(&threads[i].id, NULL, measure, &threads[i]))
+        {
+            fprintf(stderr, "Error creating threads.\n");
+            exit(1);
+        }
+    }
+
+    while (nr_ready < nr_threads + nr_hogs)
+        usleep(1000);
+
+    left.tv_sec = duration;
+    left.tv_nsec = 0;
+    while (nanosleep(&left, &left))
+        ;
+    stop = 1;
+
+    for (i = 0; i < nr_hogs; i++)
+        pthread_join(hogs[i], NULL);
+    for (i = 0; i < nr_threads; i++)
+    {
+        pthread_join(threads[i].id, NULL);
+        hist_merge(&groups[threads[i].group], &threads[i].hist);
+    }
+
+    printf("%s, priority %d, %d threads, %d hogs, %d s\n",
+           policy_name(policy), policy == SCHED_OTHER ? 0 : priority,
+           nr_threads, nr_hogs, duration);
+    printf("%-8s %-6s %9s %9s %8s %8s %8s %8s %8s\n", "thread", "group",
+           "interval", "samples", "p50", "p90", "p99", "p99.9", "max");
+    for (i = 0; i < nr_threads; i++)
+    {
+        snprintf(name, sizeof(name), "%d", i);
+        snprintf(interval, sizeof(interval), "%d", interval_us + i * distance_us);
+        snprintf(group, sizeof(group), "%s%s", group_names[threads[i].group],
+                 threads[i].joined ? "" : "*");
+        print_row(name, group, interval, &threads[i].hist);
+        unjoined += !threads[i].joined;
+    }
+    for (i = 0; i < NR_GROUPS; i++)
+    {
+        if (groups[i].total)
+            print_row("all", group_names[i], "-", &groups[i]);
+    }
+    printf("(interval in us, overshoot in us)\n");
+    if (unjoined || hogs_unjoined)
+        printf("* %d threads and %d hogs stayed out of their cgroup, "
+               "so their group is only a label\n", unjoined, hogs_unjoined);
+
+    free(threads);
+    free(groups);
+    return 0;
+}
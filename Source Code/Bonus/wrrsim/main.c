@@ -0,0 +1,163 @@
+// wrrsim: simulate a task trace, or replay a recorded one, under one WRR
+// scheduling class or the rt class and report the cpu shares, wait times,
+// slice use and pick_next_task() cost it gave.
+
+#include <unistd.h>
+
+#include "wrrsim.h"
+
+#define WRRSIM_DEFAULT_DURATION (10 * NSEC_PER_SEC)
+#define WRRSIM_MAX_SYSCTLS      32
+// rt_priority of the tasks of a recording given on the command line that
+// were not rt when recorded; they all go in the foreground group
+#define WRRSIM_REPLAY_PRIO      50
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options] <trace>\n"
+            "  <trace> is a task trace, see workload.c, or a recorded sched_switch trace\n"
+            "  -d <time>         simulate for <time>, e.g. 30s (default: the trace's, else 10s)\n"
+            "  -p <policy>       run the tasks as wrr (default), or rr or fifo in the rt class\n"
+            "  -H <hz>           timer frequency (default 100)\n"
+            "  -s <name>=<value> set a sysctl after the trace's own, may be repeated\n"
+            "  -S <seed>         seed of all random draws (default 1)\n"
+            "  -o <file>         write an ftrace style event log to <file>\n"
+            "  -q                report the totals only\n"
+            "  -l                list the sysctls and their defaults, then exit\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    struct wrrsim_workload w = { 0 };
+    struct wrrsim_result res;
+    char *sysctls[WRRSIM_MAX_SYSCTLS];
+    int nr_sysctls = 0, list = 0, summary = 0, opt, i;
+    u64 duration = 0;
+    char *eq;
+
+    while ((opt = getopt(argc, argv, "d:p:H:s:S:o:qlh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'd':
+                if (wrrsim_parse_duration(optarg, &duration) || !duration)
+                {
+                    fprintf(stderr, "wrrsim: bad duration %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'p':
+                if (!strcmp(optarg, "rr"))
+                    wrrsim_policy = SCHED_RR;
+                else if (!strcmp(optarg, "fifo"))
+                    wrrsim_policy = SCHED_FIFO;
+                else if (!strcmp(optarg, "wrr"))
+                    wrrsim_policy = SCHED_WRR;
+                else
+                {
+                    fprintf(stderr, "wrrsim: unknown policy %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'H':
+                wrrsim_hz = atoi(optarg);
+                if (wrrsim_hz < 10 || wrrsim_hz > 10000 || USEC_PER_SEC % wrrsim_hz)
+                {
+                    fprintf(stderr, "wrrsim: HZ has to divide 1000000\n");
+                    return 1;
+                }
+                break;
+            case 's':
+                if (nr_sysctls == WRRSIM_MAX_SYSCTLS || !strchr(optarg, '='))
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                sysctls[nr_sysctls++] = optarg;
+                break;
+            case 'S':
+                wrrsim_seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'o':
+                wrrsim_log = fopen(optarg, "w");
+                if (!wrrsim_log)
+                {
+                    perror(optarg);
+                    return 1;
+                }
+                break;
+            case 'q':
+                summary = 1;
+                break;
+            case 'l':
+                list = 1;
+                break;
+            default:
+                usage(argv[0]);
+                return opt != 'h';
+        }
+    }
+
+    wrrsim_init();
+
+    if (list)
+    {
+        wrrsim_list_sysctls(stdout);
+        return 0;
+    }
+
+    if (optind != argc - 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (wrrsim_is_recording(argv[optind]))
+    {
+        if (wrrsim_load_recording(argv[optind], &w, WRR_GROUP_FORE,
+                                  WRRSIM_REPLAY_PRIO, NULL, 0))
+            return 1;
+    }
+    else if (wrrsim_load_workload(argv[optind], &w))
+        return 1;
+    if (!w.nr_tasks)
+    {
+        fprintf(stderr, "wrrsim: %s has no tasks\n", argv[optind]);
+        return 1;
+    }
+
+    for (i = 0; i < 3; i++)
+    {
+        if (w.weight[i])
+            wrrsim_set_weight(i, w.weight[i]);
+    }
+
+    for (i = 0; i < nr_sysctls; i++)
+    {
+        eq = strchr(sysctls[i], '=');
+        *eq = '\0';
+        if (wrrsim_set_sysctl(sysctls[i], eq + 1))
+        {
+            fprintf(stderr, "wrrsim: cannot set %s to %s\n", sysctls[i], eq + 1);
+            return 1;
+        }
+    }
+
+    if (duration)
+        w.duration_ns = duration;
+    if (!w.duration_ns)
+        w.duration_ns = w.replay_ns ? w.replay_ns : WRRSIM_DEFAULT_DURATION;
+
+    for (i = 0; i < w.nr_tasks; i++)
+        wrrsim_add_task(w.tasks[i], i + 1);
+
+    wrrsim_run(&w, &res);
+    wrrsim_report(stdout, &w, &res, summary);
+
+    if (wrrsim_log)
+        fclose(wrrsim_log);
+
+    return 0;
+}
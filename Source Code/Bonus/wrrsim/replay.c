@@ -0,0 +1,732 @@
+// Recorded traces as workloads. The input is the ftrace text output of
+// the sched_switch and sched_wakeup events - the tracing/trace file, what
+// trace-cmd report prints, or a wrrsim -o log - or a trace-cmd trace.dat,
+// which is read through trace-cmd report.
+//
+// Every task of the trace becomes a simulated task that, from the time it
+// was first seen, alternates between running for as long as it was on a
+// cpu from one wakeup to the next sleep and sleeping for as long as it
+// slept. Preemptions do not end a run, so how long the task waited and
+// who ran in between is left to the policy under test. All tasks are put
+// on the one simulated cpu, whatever cpu they ran on when recorded.
+
+#include <fnmatch.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "wrrsim.h"
+
+#define TRACE_DAT_MAGIC "\027\010\104tracing"
+
+enum replay_state {
+    REPLAY_RUNNING,
+    REPLAY_RUNNABLE,
+    REPLAY_SLEEPING,
+    REPLAY_DEAD,
+};
+
+struct replay_task {
+    char comm[TASK_COMM_LEN];
+    int pid;
+    int rt_priority;            // 0 unless it ran with an rt prio
+    int state;
+    u64 start_ns;
+    u64 in_ns;                  // switched in at
+    u64 run_ns;                 // on a cpu since the last wakeup
+    u64 sleep_ns;               // went to sleep at
+    struct wrrsim_phase *phases;
+    int nr_phases;
+    int alloc_phases;
+    int taken;                  // by a replay line of the workload
+};
+
+// A trace is read once and shared by all replay lines that name it
+struct replay_trace {
+    char *path;
+    struct replay_task *tasks;
+    int nr_tasks;
+    int alloc_tasks;
+    int *pid_hash;              // pid to task index + 1, 0 for none
+    int hash_size;
+    u64 first_ns, last_ns;
+    struct replay_trace *next;
+};
+
+static struct replay_trace *traces;
+
+/*
+ * pid lookup: an open addressing table over the live task of every pid.
+ * A task that exits leaves its slot to whatever reuses the pid next.
+ */
+
+static int *hash_slot(struct replay_trace *tr, int pid)
+{
+    unsigned int i = (unsigned int)pid * 2654435761U;
+
+    for (i &= tr->hash_size - 1;; i = (i + 1) & (tr->hash_size - 1))
+    {
+        int idx = tr->pid_hash[i];
+
+        if (!idx || tr->tasks[idx - 1].pid == pid)
+            return &tr->pid_hash[i];
+    }
+}
+
+static int grow_hash(struct replay_trace *tr)
+{
+    int *old = tr->pid_hash, old_size = tr->hash_size, i;
+
+    tr->hash_size = old_size ? 2 * old_size : 1024;
+    tr->pid_hash = calloc(tr->hash_size, sizeof(int));
+    if (!tr->pid_hash)
+        return -1;
+
+    for (i = 0; i < old_size; i++)
+    {
+        if (old[i])
+            *hash_slot(tr, tr->tasks[old[i] - 1].pid) = old[i];
+    }
+
+    free(old);
+    return 0;
+}
+
+static struct replay_task *find_task(struct replay_trace *tr, int pid)
+{
+    int idx = *hash_slot(tr, pid);
+
+    return idx ? &tr->tasks[idx - 1] : NULL;
+}
+
+static struct replay_task *new_task(struct replay_trace *tr, int pid,
+                                    const char *comm, u64 start_ns)
+{
+    struct replay_task *r;
+    int *slot;
+
+    if (2 * tr->nr_tasks >= tr->hash_size && grow_hash(tr))
+        return NULL;
+
+    if (tr->nr_tasks == tr->alloc_tasks)
+    {
+        int alloc = tr->alloc_tasks ? 2 * tr->alloc_tasks : 64;
+        struct replay_task *tasks = realloc(tr->tasks, alloc * sizeof(*tasks));
+
+        if (!tasks)
+            return NULL;
+        tr->tasks = tasks;
+        tr->alloc_tasks = alloc;
+    }
+
+    r = &tr->tasks[tr->nr_tasks++];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->comm, sizeof(r->comm), "%s", comm);
+    r->pid = pid;
+    r->start_ns = start_ns;
+
+    // takes over the slot of an exited task of the same pid
+    slot = hash_slot(tr, pid);
+    *slot = tr->nr_tasks;
+
+    return r;
+}
+
+// Append a phase, merging it into the last one of the same type
+static int add_phase(struct replay_task *r, int type, u64 len)
+{
+    struct wrrsim_phase *ph;
+
+    if (!len)
+        return 0;
+
+    // a task first seen going to sleep starts when it wakes up
+    if (!r->nr_phases && type == WRRSIM_SLEEP)
+    {
+        r->start_ns += len;
+        return 0;
+    }
+
+    if (r->nr_phases && r->phases[r->nr_phases - 1].type == type)
+    {
+        ph = &r->phases[r->nr_phases - 1];
+        ph->min_ns = ph->max_ns = ph->min_ns + len;
+        return 0;
+    }
+
+    if (r->nr_phases == r->alloc_phases)
+    {
+        int alloc = r->alloc_phases ? 2 * r->alloc_phases : 16;
+
+        ph = realloc(r->phases, alloc * sizeof(*ph));
+        if (!ph)
+            return -1;
+        r->phases = ph;
+        r->alloc_phases = alloc;
+    }
+
+    ph = &r->phases[r->nr_phases++];
+    ph->type = type;
+    ph->min_ns = ph->max_ns = len;
+    return 0;
+}
+
+static void set_prio(struct replay_task *r, int prio)
+{
+    if (prio >= 0 && rt_prio(prio))
+        r->rt_priority = max(MAX_RT_PRIO - 1 - prio, 1);
+}
+
+/*
+ * The events
+ */
+
+struct replay_event {
+    u64 ts;
+    int type;
+    char comm[TASK_COMM_LEN], next_comm[TASK_COMM_LEN];
+    int pid, next_pid;
+    int prio, next_prio;
+    char state[8];
+};
+
+enum {
+    EV_SWITCH,
+    EV_WAKEUP,
+};
+
+static int is_preempted(const char *state)
+{
+    return state[0] == 'R';
+}
+
+static int is_dead(const char *state)
+{
+    return strpbrk(state, "XxZ") != NULL;
+}
+
+static struct replay_task *get_task(struct replay_trace *tr, int pid,
+                                    const char *comm, u64 ts)
+{
+    struct replay_task *r = find_task(tr, pid);
+
+    if (r && r->state != REPLAY_DEAD)
+        return r;
+
+    return new_task(tr, pid, comm, ts);
+}
+
+static int switch_out(struct replay_trace *tr, struct replay_event *ev)
+{
+    struct replay_task *r;
+
+    if (!ev->pid)
+        return 0;
+
+    r = find_task(tr, ev->pid);
+    if (!r || r->state == REPLAY_DEAD)
+    {
+        // running since before the trace started
+        r = new_task(tr, ev->pid, ev->comm, tr->first_ns);
+        if (!r)
+            return -1;
+        r->in_ns = tr->first_ns;
+    }
+    else if (r->state != REPLAY_RUNNING)
+        return 0;
+
+    set_prio(r, ev->prio);
+    r->run_ns += ev->ts - r->in_ns;
+
+    if (is_preempted(ev->state))
+    {
+        r->state = REPLAY_RUNNABLE;
+        return 0;
+    }
+
+    if (add_phase(r, WRRSIM_RUN, r->run_ns))
+        return -1;
+    r->run_ns = 0;
+    r->sleep_ns = ev->ts;
+    r->state = is_dead(ev->state) ? REPLAY_DEAD : REPLAY_SLEEPING;
+    return 0;
+}
+
+static int switch_in(struct replay_trace *tr, struct replay_event *ev)
+{
+    struct replay_task *r;
+
+    if (!ev->next_pid)
+        return 0;
+
+    r = get_task(tr, ev->next_pid, ev->next_comm, ev->ts);
+    if (!r)
+        return -1;
+
+    // the wakeup was not recorded
+    if (r->state == REPLAY_SLEEPING && add_phase(r, WRRSIM_SLEEP, ev->ts - r->sleep_ns))
+        return -1;
+
+    set_prio(r, ev->next_prio);
+    r->in_ns = ev->ts;
+    r->state = REPLAY_RUNNING;
+    return 0;
+}
+
+static int wake_up(struct replay_trace *tr, struct replay_event *ev)
+{
+    struct replay_task *r;
+
+    if (!ev->pid)
+        return 0;
+
+    r = find_task(tr, ev->pid);
+    if (!r || r->state == REPLAY_DEAD)
+    {
+        r = new_task(tr, ev->pid, ev->comm, ev->ts);
+        if (!r)
+            return -1;
+        r->state = REPLAY_RUNNABLE;
+    }
+    else if (r->state == REPLAY_SLEEPING)
+    {
+        if (add_phase(r, WRRSIM_SLEEP, ev->ts - r->sleep_ns))
+            return -1;
+        r->state = REPLAY_RUNNABLE;
+    }
+
+    set_prio(r, ev->prio);
+    return 0;
+}
+
+// Close the tasks at the end of the trace; a last sleep is dropped
+static int finish_trace(struct replay_trace *tr)
+{
+    struct replay_task *r;
+    int i;
+
+    for (i = 0; i < tr->nr_tasks; i++)
+    {
+        r = &tr->tasks[i];
+
+        if (r->state == REPLAY_RUNNING)
+            r->run_ns += tr->last_ns - r->in_ns;
+        if (r->state == REPLAY_RUNNING || r->state == REPLAY_RUNNABLE)
+        {
+            if (add_phase(r, WRRSIM_RUN, r->run_ns))
+                return -1;
+        }
+        if (r->nr_phases && r->phases[r->nr_phases - 1].type == WRRSIM_SLEEP)
+            r->nr_phases--;
+    }
+
+    return 0;
+}
+
+/*
+ * Parsing the text output. Events are printed either with their own
+ * format, key=value pairs, or by trace-cmd's sched plugin as
+ *
+ *   sched_switch: prev_comm:prev_pid [prev_prio] prev_state ==> next_comm:next_pid [next_prio]
+ *   sched_wakeup: comm:pid [prio] success=1 CPU:000
+ */
+
+// "  1234.567890: " before the event name, in s with up to 9 decimals
+static int parse_ts(const char *line, const char *end, u64 *ts)
+{
+    const char *s = end;
+    u64 sec, frac = 0;
+    int digits = 0;
+    char *p;
+
+    while (s > line && s[-1] != ' ')
+        s--;
+
+    sec = strtoull(s, &p, 10);
+    if (p == s)
+        return -1;
+
+    if (*p == '.')
+    {
+        for (p++; *p >= '0' && *p <= '9'; p++)
+        {
+            if (digits++ < 9)
+                frac = frac * 10 + (*p - '0');
+        }
+        for (; digits < 9; digits++)
+            frac *= 10;
+    }
+
+    if (p != end)
+        return -1;
+
+    *ts = sec * NSEC_PER_SEC + frac;
+    return 0;
+}
+
+// The value of " key=" in @s, up to " @next=" or the end of the field
+static const char *find_key(const char *s, const char *key)
+{
+    size_t len = strlen(key);
+    const char *p;
+
+    for (p = strstr(s, key); p; p = strstr(p + 1, key))
+    {
+        if ((p == s || p[-1] == ' ') && p[len] == '=')
+            return p + len + 1;
+    }
+
+    return NULL;
+}
+
+static int get_str(const char *s, const char *key, const char *next,
+                   char *buf, size_t size)
+{
+    const char *v = find_key(s, key), *end = NULL;
+    size_t len;
+
+    if (!v)
+        return -1;
+
+    if (next)
+    {
+        for (end = strstr(v, next); end; end = strstr(end + 1, next))
+        {
+            if (end[-1] == ' ' && end[strlen(next)] == '=')
+                break;
+        }
+        if (end)
+            end--;
+    }
+    if (!end)
+        end = v + strcspn(v, " \n");
+
+    len = min((size_t)(end - v), size - 1);
+    memcpy(buf, v, len);
+    buf[len] = '\0';
+    return 0;
+}
+
+static int get_int(const char *s, const char *key, int *val)
+{
+    const char *v = find_key(s, key);
+
+    if (!v)
+        return -1;
+
+    *val = atoi(v);
+    return 0;
+}
+
+// "comm:pid [prio]" of the sched plugin; returns the end of it
+static const char *get_plugin_task(const char *s, char *comm, int *pid, int *prio)
+{
+    const char *br, *colon;
+    size_t len;
+
+    s += strspn(s, " ");
+    br = strstr(s, " [");
+    if (!br)
+        return NULL;
+
+    for (colon = br; colon > s && *colon != ':'; colon--)
+        ;
+    if (*colon != ':')
+        return NULL;
+
+    len = min((size_t)(colon - s), (size_t)TASK_COMM_LEN - 1);
+    memcpy(comm, s, len);
+    comm[len] = '\0';
+    *pid = atoi(colon + 1);
+    *prio = atoi(br + 2);
+
+    br = strchr(br, ']');
+    return br ? br + 1 : NULL;
+}
+
+static int parse_switch(const char *s, struct replay_event *ev)
+{
+    const char *next;
+
+    ev->type = EV_SWITCH;
+
+    if (find_key(s, "prev_pid"))
+    {
+        if (get_str(s, "prev_comm", "prev_pid", ev->comm, sizeof(ev->comm)) ||
+            get_int(s, "prev_pid", &ev->pid) ||
+            get_int(s, "prev_prio", &ev->prio) ||
+            get_str(s, "prev_state", NULL, ev->state, sizeof(ev->state)) ||
+            get_str(s, "next_comm", "next_pid", ev->next_comm, sizeof(ev->next_comm)) ||
+            get_int(s, "next_pid", &ev->next_pid) ||
+            get_int(s, "next_prio", &ev->next_prio))
+            return -1;
+        return 0;
+    }
+
+    next = strstr(s, " ==> ");
+    if (!next)
+        return -1;
+
+    s = get_plugin_task(s, ev->comm, &ev->pid, &ev->prio);
+    if (!s || sscanf(s, " %7s", ev->state) != 1)
+        return -1;
+
+    return get_plugin_task(next + 5, ev->next_comm, &ev->next_pid, &ev->next_prio) ? 0 : -1;
+}
+
+static int parse_wakeup(const char *s, struct replay_event *ev)
+{
+    ev->type = EV_WAKEUP;
+
+    if (find_key(s, "pid"))
+    {
+        if (get_str(s, "comm", "pid", ev->comm, sizeof(ev->comm)) ||
+            get_int(s, "pid", &ev->pid))
+            return -1;
+        if (get_int(s, "prio", &ev->prio))
+            ev->prio = -1;
+        return 0;
+    }
+
+    return get_plugin_task(s, ev->comm, &ev->pid, &ev->prio) ? 0 : -1;
+}
+
+// 1 for a sched event in @ev, 0 for any other line, -1 for a broken one
+static int parse_event(const char *line, struct replay_event *ev)
+{
+    static const char *const switch_ev = ": sched_switch: ";
+    static const char *wakeups[] = { ": sched_wakeup: ", ": sched_wakeup_new: " };
+    const char *p;
+    size_t i;
+
+    if (line[0] == '#')
+        return 0;
+
+    p = strstr(line, switch_ev);
+    if (p)
+    {
+        if (parse_ts(line, p, &ev->ts) || parse_switch(p + strlen(switch_ev), ev))
+            return -1;
+        return 1;
+    }
+
+    for (i = 0; i < sizeof(wakeups) / sizeof(wakeups[0]); i++)
+    {
+        p = strstr(line, wakeups[i]);
+        if (p)
+        {
+            if (parse_ts(line, p, &ev->ts) || parse_wakeup(p + strlen(wakeups[i]), ev))
+                return -1;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Reading a trace
+ */
+
+static int is_trace_dat(const char *path)
+{
+    char magic[sizeof(TRACE_DAT_MAGIC) - 1];
+    FILE *f = fopen(path, "rb");
+    int ret;
+
+    if (!f)
+        return 0;
+
+    ret = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+          !memcmp(magic, TRACE_DAT_MAGIC, sizeof(magic));
+    fclose(f);
+    return ret;
+}
+
+// Is @path a recorded trace rather than a task trace?
+int wrrsim_is_recording(const char *path)
+{
+    char line[1024];
+    int lines = 0, ret = 0;
+    FILE *f;
+
+    if (!strcmp(path, "-"))
+        return 0;
+    if (is_trace_dat(path))
+        return 1;
+
+    f = fopen(path, "r");
+    if (!f)
+        return 0;
+
+    while (!ret && lines++ < 64 && fgets(line, sizeof(line), f))
+    {
+        ret = !strncmp(line, "# tracer:", 9) ||
+              strstr(line, ": sched_switch: ") || strstr(line, ": sched_wakeup");
+    }
+
+    fclose(f);
+    return ret;
+}
+
+// trace-cmd report -i @path, read through a pipe
+static FILE *open_trace_dat(const char *path, pid_t *child)
+{
+    int fds[2];
+    FILE *f;
+
+    if (pipe(fds))
+        return NULL;
+
+    *child = fork();
+    if (*child < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return NULL;
+    }
+
+    if (!*child)
+    {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execlp("trace-cmd", "trace-cmd", "report", "-i", path, (char *)NULL);
+        fprintf(stderr, "wrrsim: reading %s needs trace-cmd: %s\n", path, strerror(errno));
+        _exit(127);
+    }
+
+    close(fds[1]);
+    f = fdopen(fds[0], "r");
+    if (!f)
+        close(fds[0]);
+    return f;
+}
+
+static struct replay_trace *read_trace(const char *path)
+{
+    struct replay_trace *tr;
+    struct replay_event ev;
+    char line[4096];
+    int lineno = 0, ret = 0, status;
+    pid_t child = 0;
+    FILE *f;
+
+    for (tr = traces; tr; tr = tr->next)
+    {
+        if (!strcmp(tr->path, path))
+            return tr;
+    }
+
+    tr = calloc(1, sizeof(*tr));
+    if (!tr || !(tr->path = strdup(path)) || grow_hash(tr))
+        return NULL;
+
+    f = is_trace_dat(path) ? open_trace_dat(path, &child) : fopen(path, "r");
+    if (!f)
+    {
+        perror(path);
+        return NULL;
+    }
+
+    while (!ret && fgets(line, sizeof(line), f))
+    {
+        lineno++;
+        memset(&ev, 0, sizeof(ev));
+
+        ret = parse_event(line, &ev);
+        if (ret < 0)
+        {
+            fprintf(stderr, "%s:%d: cannot parse this event\n", path, lineno);
+            break;
+        }
+        if (!ret)
+            continue;
+
+        if (!tr->first_ns)
+            tr->first_ns = ev.ts;
+        // per-cpu buffers are merged by time, but allow for clock skew
+        ev.ts = max(ev.ts, tr->last_ns);
+        tr->last_ns = ev.ts;
+
+        if (ev.type == EV_WAKEUP)
+            ret = wake_up(tr, &ev);
+        else
+            ret = switch_out(tr, &ev) || switch_in(tr, &ev) ? -1 : 0;
+    }
+
+    fclose(f);
+    if (child > 0 && (waitpid(child, &status, 0) < 0 || !WIFEXITED(status) ||
+                      WEXITSTATUS(status)))
+        ret = -1;
+
+    if (ret || finish_trace(tr))
+        return NULL;
+
+    if (!tr->first_ns)
+    {
+        fprintf(stderr, "%s: no sched_switch or sched_wakeup events\n", path);
+        return NULL;
+    }
+
+    tr->next = traces;
+    traces = tr;
+    return tr;
+}
+
+static int comm_matches(const char *comm, char **patterns, int nr_patterns)
+{
+    int i;
+
+    if (!nr_patterns)
+        return 1;
+
+    for (i = 0; i < nr_patterns; i++)
+    {
+        if (!fnmatch(patterns[i], comm, 0))
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Add the tasks of the recorded trace @path whose comm matches one of
+ * @patterns, or all if there are none, to @w in @group. Tasks that ran
+ * with an rt priority keep it as their rt_priority; the others get
+ * @rt_priority. Tasks taken by an earlier call for the same trace are
+ * skipped, so that a trace can be split between the groups.
+ */
+int wrrsim_load_recording(const char *path, struct wrrsim_workload *w, int group,
+                          int rt_priority, char **patterns, int nr_patterns)
+{
+    struct replay_trace *tr = read_trace(path);
+    struct replay_task *r;
+    struct wrrsim_task *t;
+    int i;
+
+    if (!tr)
+        return -1;
+
+    w->replay_ns = max(w->replay_ns, tr->last_ns - tr->first_ns);
+
+    for (i = 0; i < tr->nr_tasks; i++)
+    {
+        r = &tr->tasks[i];
+        if (r->taken || !r->nr_phases || !comm_matches(r->comm, patterns, nr_patterns))
+            continue;
+
+        t = wrrsim_new_task(w, r->comm);
+        if (!t)
+            return -1;
+
+        t->group = group;
+        t->task.rt_priority = r->rt_priority ? r->rt_priority : rt_priority;
+        t->start_ns = r->start_ns - tr->first_ns;
+        t->phases = r->phases;
+        t->nr_phases = r->nr_phases;
+        t->repeat = 1;
+        r->taken = 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,282 @@
+// Summary of a simulated run: what every task and every group class got,
+// how long wakeups waited for the cpu, how much of their slices tasks used
+// and what pick_next_task() cost.
+
+#include "wrrsim.h"
+
+void wrrsim_sample_add(struct wrrsim_samples *s, u64 ns)
+{
+    if (s->nr == s->alloc)
+    {
+        size_t alloc = s->alloc ? 2 * s->alloc : 256;
+        u64 *p = realloc(s->ns, alloc * sizeof(*p));
+
+        if (!p)
+            return;
+        s->ns = p;
+        s->alloc = alloc;
+    }
+
+    s->ns[s->nr++] = ns;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+// Sorts @s in place; @pct in [0, 100]
+static u64 percentile(struct wrrsim_samples *s, double pct)
+{
+    size_t i;
+
+    if (!s->nr)
+        return 0;
+
+    qsort(s->ns, s->nr, sizeof(*s->ns), cmp_u64);
+    i = (size_t)(pct / 100 * s->nr + 0.999999);
+    return s->ns[i ? i - 1 : 0];
+}
+
+static double mean(const struct wrrsim_samples *s)
+{
+    double sum = 0;
+    size_t i;
+
+    for (i = 0; i < s->nr; i++)
+        sum += s->ns[i];
+
+    return s->nr ? sum / s->nr : 0;
+}
+
+#define WRRSIM_MAX_EVENTS 16
+
+static struct {
+    const char *name;
+    u64 count;
+} events[WRRSIM_MAX_EVENTS];
+static int nr_events;
+
+void wrrsim_trace_count(const char *event)
+{
+    int i;
+
+    for (i = 0; i < nr_events; i++)
+    {
+        if (!strcmp(events[i].name, event))
+        {
+            events[i].count++;
+            return;
+        }
+    }
+
+    if (nr_events < WRRSIM_MAX_EVENTS)
+    {
+        events[nr_events].name = event;
+        events[nr_events++].count = 1;
+    }
+}
+
+/*
+ * The share of its runnable time @t spent on the cpu rather than queued.
+ * Tasks of the same level and group should get the same under any fair
+ * policy, whatever their sleep pattern.
+ */
+static double runnable_share(struct wrrsim_task *t)
+{
+    if (!t->runtime_ns && !t->wait_sum_ns)
+        return -1;
+
+    return (double)t->runtime_ns / (t->runtime_ns + t->wait_sum_ns);
+}
+
+static double slice_use(u64 used, u64 given)
+{
+    return given ? 100.0 * used / given : 0;
+}
+
+static void report_tasks(FILE *out, struct wrrsim_workload *w, struct wrrsim_result *res)
+{
+    int wrr = wrr_policy(wrrsim_policy);
+    struct sched_wrr_statistics *st;
+    struct wrrsim_task *t;
+    int i;
+
+    fprintf(out, "%-15s %5s %-5s %4s %10s %6s %7s %9s %9s %9s",
+            "task", "pid", "group", "prio", "run(ms)", "cpu%", "wakeups",
+            "lat50(us)", "lat99(us)", "latmax");
+    if (wrr)
+        fprintf(out, " %9s %7s %6s %6s %6s %6s",
+                "delay(us)", "slices", "vol", "invol", "stages", "boosts");
+    fputc('\n', out);
+
+    for (i = 0; i < w->nr_tasks; i++)
+    {
+        t = w->tasks[i];
+        st = &t->task.wrr.statistics;
+
+        fprintf(out, "%-15s %5d %-5s %4u %10.1f %6.2f %7llu %9.1f %9.1f %9.1f",
+                t->task.comm, t->task.pid, wrrsim_group_name(t->group), t->task.rt_priority,
+                t->runtime_ns / 1e6, 100.0 * t->runtime_ns / res->duration_ns,
+                (unsigned long long)t->nr_wakeups,
+                percentile(&t->latency, 50) / 1e3,
+                percentile(&t->latency, 99) / 1e3,
+                percentile(&t->latency, 100) / 1e3);
+        if (wrr)
+            fprintf(out, " %9.1f %7llu %6llu %6llu %6llu %6llu",
+                    st->wait_count ? st->wait_sum / 1e3 / st->wait_count : 0.0,
+                    (unsigned long long)st->nr_slice_expired,
+                    (unsigned long long)st->nr_voluntary_switches,
+                    (unsigned long long)st->nr_involuntary_switches,
+                    (unsigned long long)st->nr_prio_changes,
+                    (unsigned long long)st->nr_wakeup_boosts);
+        fputc('\n', out);
+    }
+}
+
+/*
+ * Per task: how often it got the cpu, how long it waited for it each time
+ * it became runnable or was preempted, and how much of the slices it got
+ * it used before giving up the cpu or being preempted.
+ */
+static void report_waits(FILE *out, struct wrrsim_workload *w, struct wrrsim_result *res)
+{
+    struct wrrsim_task *t;
+    int i;
+
+    fprintf(out, "\n%-15s %5s %8s %7s %10s %10s %10s %10s %7s\n",
+            "task", "pid", "runs/s", "waits", "wait50(us)", "wait90(us)", "wait99(us)",
+            "waitmax", "slice%");
+
+    for (i = 0; i < w->nr_tasks; i++)
+    {
+        t = w->tasks[i];
+
+        fprintf(out, "%-15s %5d %8.1f %7zu %10.1f %10.1f %10.1f %10.1f %7.1f\n",
+                t->task.comm, t->task.pid, t->nr_runs * 1e9 / res->duration_ns,
+                t->wait.nr,
+                percentile(&t->wait, 50) / 1e3,
+                percentile(&t->wait, 90) / 1e3,
+                percentile(&t->wait, 99) / 1e3,
+                percentile(&t->wait, 100) / 1e3,
+                slice_use(t->slice_used_ns, t->slice_given_ns));
+    }
+}
+
+/*
+ * Per group class: its cpu share, the wakeup latency over all its tasks,
+ * and Jain's fairness index of the runnable shares of its tasks, 1.0 when
+ * they all got the same and 1/n when one of n got everything.
+ */
+static void report_groups(FILE *out, struct wrrsim_workload *w, struct wrrsim_result *res)
+{
+    int group, i, n;
+
+    fprintf(out, "\n%-5s %5s %6s %9s %9s %9s %6s\n",
+            "group", "tasks", "cpu%", "lat50(us)", "lat99(us)", "latmax", "jain");
+
+    for (group = 0; group < 3; group++)
+    {
+        struct wrrsim_samples lat = { 0 };
+        double x, sum = 0, sum2 = 0;
+        u64 runtime = 0;
+
+        for (i = n = 0; i < w->nr_tasks; i++)
+        {
+            struct wrrsim_task *t = w->tasks[i];
+            size_t j;
+
+            if (t->group != group)
+                continue;
+
+            runtime += t->runtime_ns;
+            for (j = 0; j < t->latency.nr; j++)
+                wrrsim_sample_add(&lat, t->latency.ns[j]);
+
+            x = runnable_share(t);
+            if (x < 0)
+                continue;
+            sum += x;
+            sum2 += x * x;
+            n++;
+        }
+
+        if (!n)
+            continue;
+
+        fprintf(out, "%-5s %5d %6.2f %9.1f %9.1f %9.1f %6.3f\n",
+                wrrsim_group_name(group), n, 100.0 * runtime / res->duration_ns,
+                percentile(&lat, 50) / 1e3, percentile(&lat, 99) / 1e3,
+                percentile(&lat, 100) / 1e3,
+                sum2 ? sum * sum / (n * sum2) : 1.0);
+        free(lat.ns);
+    }
+}
+
+// Over all tasks: waits, slice use and context switches
+static void report_totals(FILE *out, struct wrrsim_workload *w, struct wrrsim_result *res)
+{
+    struct wrrsim_samples wait = { 0 };
+    u64 used = 0, given = 0;
+    int i;
+    size_t j;
+
+    for (i = 0; i < w->nr_tasks; i++)
+    {
+        struct wrrsim_task *t = w->tasks[i];
+
+        for (j = 0; j < t->wait.nr; j++)
+            wrrsim_sample_add(&wait, t->wait.ns[j]);
+        used += t->slice_used_ns;
+        given += t->slice_given_ns;
+    }
+
+    fprintf(out, "\ncpu busy %.2f%%, %llu context switches (%.1f/s), %llu ticks\n",
+            100.0 - 100.0 * res->idle_ns / res->duration_ns,
+            (unsigned long long)res->nr_switches, res->nr_switches * 1e9 / res->duration_ns,
+            (unsigned long long)res->nr_ticks);
+
+    fprintf(out, "waits: %zu, p50 %.1f us, p90 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n",
+            wait.nr, percentile(&wait, 50) / 1e3, percentile(&wait, 90) / 1e3,
+            percentile(&wait, 99) / 1e3, percentile(&wait, 99.9) / 1e3,
+            percentile(&wait, 100) / 1e3);
+    free(wait.ns);
+
+    if (given)
+        fprintf(out, "slice use %.1f%%\n", slice_use(used, given));
+
+    fprintf(out, "pick_next_task_%s: %zu calls, mean %.1f ns, p50 %llu ns, p99 %llu ns, max %llu ns\n",
+            wrr_policy(wrrsim_policy) ? "wrr" : "rt",
+            res->pick_ns.nr, mean(&res->pick_ns),
+            (unsigned long long)percentile(&res->pick_ns, 50),
+            (unsigned long long)percentile(&res->pick_ns, 99),
+            (unsigned long long)percentile(&res->pick_ns, 100));
+}
+
+// With @summary only the totals, to compare policies side by side
+void wrrsim_report(FILE *out, struct wrrsim_workload *w, struct wrrsim_result *res,
+                   int summary)
+{
+    int i;
+
+    fprintf(out, "policy %s, %d tasks, %.3f s at HZ=%u\n",
+            wrrsim_policy_name(), w->nr_tasks, res->duration_ns / 1e9, HZ);
+
+    if (summary)
+    {
+        report_totals(out, w, res);
+        return;
+    }
+
+    fputc('\n', out);
+    report_tasks(out, w, res);
+    report_waits(out, w, res);
+    report_groups(out, w, res);
+    report_totals(out, w, res);
+
+    fprintf(out, "\n%-24s %10s\n", "event", "count");
+    for (i = 0; i < nr_events; i++)
+        fprintf(out, "%-24s %10llu\n", events[i].name, (unsigned long long)events[i].count);
+}
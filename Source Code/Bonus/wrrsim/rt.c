@@ -0,0 +1,161 @@
+// SCHED_FIFO and SCHED_RR as kernel/sched/rt.c schedules them on one cpu
+// with no rt bandwidth limit: the reference the WRR classes are replayed
+// against with -p rr. The real rt.c needs hrtimers and cpupri, which the
+// shim does not have, so this keeps only its queueing and timeslice rules.
+
+#include "sched.h"
+
+void init_rt_rq(struct rt_rq *rt_rq)
+{
+    struct rt_prio_array *array = &rt_rq->active;
+    int i;
+
+    for (i = 0; i < MAX_RT_PRIO; i++)
+    {
+        INIT_LIST_HEAD(array->queue + i);
+        __clear_bit(i, array->bitmap);
+    }
+    // delimiter for bitsearch
+    __set_bit(MAX_RT_PRIO, array->bitmap);
+
+    rt_rq->rt_nr_running = 0;
+}
+
+static void update_curr_rt(struct rq *rq)
+{
+    struct task_struct *curr = rq->curr;
+    u64 delta_exec;
+
+    if (curr->sched_class != &rt_sched_class)
+        return;
+
+    delta_exec = rq->clock_task - curr->se.exec_start;
+    if (unlikely((s64)delta_exec < 0))
+        delta_exec = 0;
+
+    curr->se.sum_exec_runtime += delta_exec;
+    curr->se.exec_start = rq->clock_task;
+}
+
+static void enqueue_task_rt(struct rq *rq, struct task_struct *p, int flags)
+{
+    struct rt_prio_array *array = &rq->rt.active;
+    struct list_head *queue = array->queue + p->prio;
+
+    if (flags & ENQUEUE_HEAD)
+        list_add(&p->rt.run_list, queue);
+    else
+        list_add_tail(&p->rt.run_list, queue);
+    __set_bit(p->prio, array->bitmap);
+
+    rq->rt.rt_nr_running++;
+    inc_nr_running(rq);
+}
+
+static void dequeue_task_rt(struct rq *rq, struct task_struct *p, int flags)
+{
+    struct rt_prio_array *array = &rq->rt.active;
+
+    update_curr_rt(rq);
+
+    list_del_init(&p->rt.run_list);
+    if (list_empty(array->queue + p->prio))
+        __clear_bit(p->prio, array->bitmap);
+
+    rq->rt.rt_nr_running--;
+    dec_nr_running(rq);
+}
+
+static void requeue_task_rt(struct rq *rq, struct task_struct *p, int head)
+{
+    struct list_head *queue = rq->rt.active.queue + p->prio;
+
+    if (head)
+        list_move(&p->rt.run_list, queue);
+    else
+        list_move_tail(&p->rt.run_list, queue);
+}
+
+static void yield_task_rt(struct rq *rq)
+{
+    requeue_task_rt(rq, rq->curr, 0);
+}
+
+// Preempt the current task with a newly woken task if needed
+static void check_preempt_curr_rt(struct rq *rq, struct task_struct *p, int flags)
+{
+    if (p->prio < rq->curr->prio)
+        resched_task(rq->curr);
+}
+
+static struct task_struct *pick_next_task_rt(struct rq *rq)
+{
+    struct rt_prio_array *array = &rq->rt.active;
+    struct task_struct *p;
+    int idx;
+
+    if (!rq->rt.rt_nr_running)
+        return NULL;
+
+    idx = find_first_bit(array->bitmap, MAX_RT_PRIO + 1);
+    BUG_ON(idx >= MAX_RT_PRIO);
+
+    p = list_entry(array->queue[idx].next, struct task_struct, rt.run_list);
+    p->se.exec_start = rq->clock_task;
+
+    return p;
+}
+
+static void put_prev_task_rt(struct rq *rq, struct task_struct *p)
+{
+    update_curr_rt(rq);
+}
+
+static void task_tick_rt(struct rq *rq, struct task_struct *p, int queued)
+{
+    update_curr_rt(rq);
+
+    /*
+     * RR tasks need a special form of timeslice management.
+     * FIFO tasks have no timeslices.
+     */
+    if (p->policy != SCHED_RR)
+        return;
+
+    if (--p->rt.time_slice)
+        return;
+
+    p->rt.time_slice = RR_TIMESLICE;
+
+    // Requeue to the end of queue if we are not the only element on it
+    if (p->rt.run_list.prev != p->rt.run_list.next)
+    {
+        requeue_task_rt(rq, p, 0);
+        set_tsk_need_resched(p);
+    }
+}
+
+static unsigned int get_rr_interval_rt(struct rq *rq, struct task_struct *task)
+{
+    // Time slice is 0 for SCHED_FIFO tasks
+    if (task->policy == SCHED_RR)
+        return RR_TIMESLICE;
+
+    return 0;
+}
+
+const struct sched_class rt_sched_class = {
+    .next = &wrr_sched_class,
+    .enqueue_task = enqueue_task_rt,
+    .dequeue_task = dequeue_task_rt,
+    .yield_task = yield_task_rt,
+
+    .check_preempt_curr = check_preempt_curr_rt,
+
+    .pick_next_task = pick_next_task_rt,
+    .put_prev_task = put_prev_task_rt,
+
+    .task_tick = task_tick_rt,
+
+    .get_rr_interval = get_rr_interval_rt,
+};
@@ -0,0 +1,267 @@
+// The bits of the kernel's basic headers that the WRR classes use, for a
+// single-cpu userspace build. Locks, RCU and per-cpu data collapse to
+// plain accesses since the simulator is single threaded.
+
+#ifndef _WRRSIM_LINUX_KERNEL_H
+#define _WRRSIM_LINUX_KERNEL_H
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t s32;
+typedef int64_t s64;
+
+#define likely(x)               __builtin_expect(!!(x), 1)
+#define unlikely(x)             __builtin_expect(!!(x), 0)
+#define __read_mostly
+#define __init
+#define ____cacheline_aligned_in_smp
+#define ACCESS_ONCE(x)          (*(volatile __typeof__(x) *)&(x))
+
+#define container_of(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define min(x, y)               ((x) < (y) ? (x) : (y))
+#define max(x, y)               ((x) > (y) ? (x) : (y))
+#define min_t(type, x, y)       ((type)(x) < (type)(y) ? (type)(x) : (type)(y))
+#define max_t(type, x, y)       ((type)(x) > (type)(y) ? (type)(x) : (type)(y))
+#define DIV_ROUND_UP(n, d)      (((n) + (d) - 1) / (d))
+
+extern void wrrsim_bug(const char *file, int line, const char *cond);
+extern void wrrsim_warn(const char *file, int line, const char *cond);
+
+#define BUG()                   wrrsim_bug(__FILE__, __LINE__, "BUG")
+#define BUG_ON(cond)            do { if (unlikely(cond)) wrrsim_bug(__FILE__, __LINE__, #cond); } while (0)
+#define WARN_ON(cond)           ({ int __c = !!(cond); if (unlikely(__c)) wrrsim_warn(__FILE__, __LINE__, #cond); __c; })
+#define WARN_ON_ONCE(cond)      WARN_ON(cond)
+#define BUILD_BUG_ON(cond)      ((void)sizeof(char[1 - 2 * !!(cond)]))
+
+#define printk(fmt, ...)        do { } while (0)
+#define printk_sched(fmt, ...)  do { } while (0)
+
+// late_initcall()s run in link order once the class is initialised
+typedef int (*initcall_t)(void);
+extern void wrrsim_add_initcall(initcall_t fn);
+#define late_initcall(fn) \
+    static void __attribute__((constructor)) __wrrsim_initcall_##fn(void) \
+    { \
+        wrrsim_add_initcall(fn); \
+    }
+
+// Time: HZ is a run time setting of the simulator
+extern unsigned int wrrsim_hz;
+extern unsigned long jiffies;
+#define HZ                      wrrsim_hz
+#define NSEC_PER_USEC           1000ULL
+#define NSEC_PER_MSEC           1000000ULL
+#define NSEC_PER_SEC            1000000000ULL
+#define USEC_PER_MSEC           1000UL
+#define USEC_PER_SEC            1000000UL
+#define MSEC_PER_SEC            1000UL
+
+static inline unsigned int jiffies_to_usecs(unsigned long j)
+{
+    return (unsigned int)(j * (USEC_PER_SEC / HZ));
+}
+
+static inline unsigned long usecs_to_jiffies(unsigned int u)
+{
+    return DIV_ROUND_UP((unsigned long)u, USEC_PER_SEC / HZ);
+}
+
+static inline unsigned long msecs_to_jiffies(unsigned int m)
+{
+    return DIV_ROUND_UP((unsigned long)m, MSEC_PER_SEC / HZ);
+}
+
+#define time_after(a, b)        ((long)((b) - (a)) < 0)
+#define time_before(a, b)       time_after(b, a)
+#define time_after_eq(a, b)     ((long)((a) - (b)) >= 0)
+
+static inline u64 div_u64(u64 dividend, u32 divisor)
+{
+    return dividend / divisor;
+}
+
+static inline u64 div64_u64(u64 dividend, u64 divisor)
+{
+    return dividend / divisor;
+}
+
+static inline u64 get_cycles(void)
+{
+    return 0;
+}
+
+// Locking, RCU and per-cpu data on a single cpu
+typedef struct { int unused; } raw_spinlock_t;
+#define raw_spin_lock_init(l)                   do { (void)(l); } while (0)
+#define raw_spin_lock(l)                        do { (void)(l); } while (0)
+#define raw_spin_unlock(l)                      do { (void)(l); } while (0)
+#define raw_spin_lock_irq(l)                    do { (void)(l); } while (0)
+#define raw_spin_unlock_irq(l)                  do { (void)(l); } while (0)
+#define raw_spin_lock_irqsave(l, flags)         do { (void)(l); (flags) = 0; } while (0)
+#define raw_spin_unlock_irqrestore(l, flags)    do { (void)(l); (void)(flags); } while (0)
+#define rcu_read_lock()                         do { } while (0)
+#define rcu_read_unlock()                       do { } while (0)
+
+#define NR_CPUS                 1
+#define nr_cpu_ids              1
+#define smp_processor_id()      0
+#define cpu_to_node(cpu)        0
+#define for_each_possible_cpu(cpu) for ((cpu) = 0; (cpu) < NR_CPUS; (cpu)++)
+
+#define DEFINE_PER_CPU(type, name)      __typeof__(type) name
+#define DECLARE_PER_CPU(type, name)     extern __typeof__(type) name
+#define per_cpu(var, cpu)               (*((void)(cpu), &(var)))
+#define __get_cpu_var(var)              (var)
+
+// Lists, with the RCU variants reduced to the plain ones
+struct list_head {
+    struct list_head *next, *prev;
+};
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+    list->next = list;
+    list->prev = list;
+}
+
+static inline void __list_add(struct list_head *new, struct list_head *prev,
+                              struct list_head *next)
+{
+    next->prev = new;
+    new->next = next;
+    new->prev = prev;
+    prev->next = new;
+}
+
+static inline void list_add(struct list_head *new, struct list_head *head)
+{
+    __list_add(new, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head *new, struct list_head *head)
+{
+    __list_add(new, head->prev, head);
+}
+
+static inline void __list_del(struct list_head *prev, struct list_head *next)
+{
+    next->prev = prev;
+    prev->next = next;
+}
+
+static inline void list_del(struct list_head *entry)
+{
+    __list_del(entry->prev, entry->next);
+    entry->next = NULL;
+    entry->prev = NULL;
+}
+
+static inline void list_del_init(struct list_head *entry)
+{
+    __list_del(entry->prev, entry->next);
+    INIT_LIST_HEAD(entry);
+}
+
+static inline void list_move(struct list_head *list, struct list_head *head)
+{
+    __list_del(list->prev, list->next);
+    list_add(list, head);
+}
+
+static inline void list_move_tail(struct list_head *list, struct list_head *head)
+{
+    __list_del(list->prev, list->next);
+    list_add_tail(list, head);
+}
+
+static inline int list_empty(const struct list_head *head)
+{
+    return head->next == head;
+}
+
+static inline void list_splice_tail_init(struct list_head *list, struct list_head *head)
+{
+    if (!list_empty(list))
+    {
+        struct list_head *first = list->next;
+        struct list_head *last = list->prev;
+        struct list_head *at = head->prev;
+
+        first->prev = at;
+        at->next = first;
+        last->next = head;
+        head->prev = last;
+        INIT_LIST_HEAD(list);
+    }
+}
+
+#define list_add_rcu(new, head) list_add(new, head)
+#define list_del_rcu(entry)     list_del(entry)
+
+#define list_entry(ptr, type, member)       container_of(ptr, type, member)
+#define list_first_entry(ptr, type, member) list_entry((ptr)->next, type, member)
+
+#define list_for_each_entry(pos, head, member)                          \
+    for (pos = list_entry((head)->next, __typeof__(*pos), member);     \
+         &pos->member != (head);                                        \
+         pos = list_entry(pos->member.next, __typeof__(*pos), member))
+
+// Bitmaps
+#define BITS_PER_LONG           (8 * (int)sizeof(long))
+#define BITS_TO_LONGS(nr)       DIV_ROUND_UP(nr, BITS_PER_LONG)
+#define DECLARE_BITMAP(name, bits) unsigned long name[BITS_TO_LONGS(bits)]
+
+static inline void __set_bit(int nr, unsigned long *addr)
+{
+    addr[nr / BITS_PER_LONG] |= 1UL << (nr % BITS_PER_LONG);
+}
+
+static inline void __clear_bit(int nr, unsigned long *addr)
+{
+    addr[nr / BITS_PER_LONG] &= ~(1UL << (nr % BITS_PER_LONG));
+}
+
+static inline int test_bit(int nr, const unsigned long *addr)
+{
+    return (addr[nr / BITS_PER_LONG] >> (nr % BITS_PER_LONG)) & 1;
+}
+
+static inline void bitmap_zero(unsigned long *dst, int nbits)
+{
+    memset(dst, 0, BITS_TO_LONGS(nbits) * sizeof(long));
+}
+
+static inline int find_next_bit(const unsigned long *addr, int size, int offset)
+{
+    while (offset < size)
+    {
+        unsigned long word = addr[offset / BITS_PER_LONG] >> (offset % BITS_PER_LONG);
+
+        if (word)
+            return min(offset + __builtin_ctzl(word), size);
+        offset = (offset / BITS_PER_LONG + 1) * BITS_PER_LONG;
+    }
+
+    return size;
+}
+
+static inline int find_first_bit(const unsigned long *addr, int size)
+{
+    return find_next_bit(addr, size, 0);
+}
+
+#endif /* _WRRSIM_LINUX_KERNEL_H */
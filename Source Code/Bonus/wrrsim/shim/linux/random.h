@@ -0,0 +1,41 @@
+// The kernel's taus88 generator, so that a seeded run draws the same
+// numbers as the kernel would. get_random_bytes() is seeded by wrrsim -S
+// and therefore reproducible too.
+
+#ifndef _WRRSIM_LINUX_RANDOM_H
+#define _WRRSIM_LINUX_RANDOM_H
+
+#include <linux/kernel.h>
+
+struct rnd_state {
+    u32 s1, s2, s3;
+};
+
+static inline u32 __seed(u32 x, u32 m)
+{
+    return (x < m) ? x + m : x;
+}
+
+static inline void prandom32_seed(struct rnd_state *state, u64 seed)
+{
+    u32 i = (seed >> 32) ^ (seed << 10) ^ seed;
+
+    state->s1 = __seed(i, 1);
+    state->s2 = __seed(i, 7);
+    state->s3 = __seed(i, 15);
+}
+
+static inline u32 prandom32(struct rnd_state *state)
+{
+#define TAUSWORTHE(s, a, b, c, d) (((s) & (c)) << (d)) ^ ((((s) << (a)) ^ (s)) >> (b))
+
+    state->s1 = TAUSWORTHE(state->s1, 13, 19, 4294967294U, 12);
+    state->s2 = TAUSWORTHE(state->s2, 2, 25, 4294967288U, 4);
+    state->s3 = TAUSWORTHE(state->s3, 3, 11, 4294967280U, 17);
+
+    return (state->s1 ^ state->s2 ^ state->s3);
+}
+
+extern void get_random_bytes(void *buf, int nbytes);
+
+#endif /* _WRRSIM_LINUX_RANDOM_H */
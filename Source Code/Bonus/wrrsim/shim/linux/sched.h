@@ -0,0 +1,155 @@
+// Userspace stand-in for include/linux/sched.h: the task_struct fields
+// and SCHED_WRR definitions the WRR classes touch. struct sched_wrr_entity
+// and struct sched_wrr_statistics are copied from the kernel header and
+// have to be kept in step with it.
+
+#ifndef _WRRSIM_LINUX_SCHED_H
+#define _WRRSIM_LINUX_SCHED_H
+
+#include <linux/kernel.h>
+
+#define SCHED_NORMAL            0
+#define SCHED_FIFO              1
+#define SCHED_RR                2
+#define SCHED_BATCH             3
+#define SCHED_IDLE              5
+#define SCHED_WRR               6
+
+#define TASK_COMM_LEN           16
+
+#define MAX_USER_RT_PRIO        100
+#define MAX_RT_PRIO             MAX_USER_RT_PRIO
+
+static inline int rt_prio(int prio)
+{
+    return prio < MAX_RT_PRIO;
+}
+
+#define RR_TIMESLICE            (100 * HZ / 1000)
+
+#define MAX_USER_WRR_PRIO       100
+#define MAX_WRR_PRIO            MAX_USER_WRR_PRIO
+
+// The bitmap of a wrr_prio_array has MAX_WRR_PRIO levels and a delimiter bit
+static inline int sched_find_first_bit(const unsigned long *b)
+{
+    return find_first_bit(b, MAX_WRR_PRIO + 1);
+}
+
+#define ENQUEUE_WAKEUP          1
+#define ENQUEUE_HEAD            2
+#define ENQUEUE_WAKING          0
+#define DEQUEUE_SLEEP           1
+
+#define WRR_FORE_TIMESLICE_US       100000
+#define WRR_BACK_TIMESLICE_US       10000
+#define WRR_WAKEUP_GRANULARITY_US   2000
+
+#define WRR_DEFAULT_WEIGHT      100
+#define WRR_MIN_WEIGHT          1
+#define WRR_MAX_WEIGHT          10000
+
+extern unsigned int sysctl_sched_wrr_fore_timeslice_us;
+extern unsigned int sysctl_sched_wrr_back_timeslice_us;
+extern unsigned int sysctl_sched_wrr_wakeup_granularity_us;
+
+struct wrr_rq;
+struct task_group;
+struct sched_class;
+
+#ifdef CONFIG_SCHEDSTATS
+struct sched_statistics {
+    u64 exec_max;
+};
+
+struct sched_wrr_statistics {
+    u64 wait_start;
+    u64 wait_max;
+    u64 wait_count;
+    u64 wait_sum;
+
+    u64 nr_slice_expired;
+    u64 nr_voluntary_switches;
+    u64 nr_involuntary_switches;
+    u64 nr_prio_changes;
+    u64 nr_wakeup_boosts;
+    u64 nr_migrations;
+};
+#endif
+
+struct sched_entity {
+    u64 exec_start;
+    u64 sum_exec_runtime;
+#ifdef CONFIG_SCHEDSTATS
+    struct sched_statistics statistics;
+#endif
+};
+
+struct sched_rt_entity {
+    struct list_head run_list;
+    unsigned int time_slice;
+    int nr_cpus_allowed;
+};
+
+struct sched_wrr_entity {
+    struct list_head run_list;
+    unsigned int time_slice;
+    unsigned int weight;
+    int prio;
+
+    struct sched_wrr_entity *back;
+    struct sched_wrr_entity *parent;
+    struct wrr_rq *wrr_rq;
+    struct wrr_rq *my_q;
+
+    u64 fb_exec_start;
+    u64 fb_sleep;
+    u64 fb_sleep_start;
+    u64 avg_run;
+    u64 avg_sleep;
+    int boosted;
+
+#ifdef CONFIG_SCHEDSTATS
+    struct sched_wrr_statistics statistics;
+#endif
+};
+
+#define TIF_NEED_RESCHED        0
+
+struct task_struct {
+    char comm[TASK_COMM_LEN];
+    pid_t pid;
+    int on_rq;
+    int prio;
+    unsigned int policy;
+    unsigned int rt_priority;
+    unsigned long thread_flags;
+    const struct sched_class *sched_class;
+    struct sched_entity se;
+    struct sched_rt_entity rt;
+    struct sched_wrr_entity wrr;
+    // consecutive requeues in the same RMLFQ stage
+    int times;
+    struct task_group *sched_task_group;
+};
+
+static inline void set_tsk_need_resched(struct task_struct *tsk)
+{
+    tsk->thread_flags |= 1UL << TIF_NEED_RESCHED;
+}
+
+static inline void clear_tsk_need_resched(struct task_struct *tsk)
+{
+    tsk->thread_flags &= ~(1UL << TIF_NEED_RESCHED);
+}
+
+static inline int test_tsk_need_resched(struct task_struct *tsk)
+{
+    return (tsk->thread_flags >> TIF_NEED_RESCHED) & 1;
+}
+
+// The task the simulated cpu is running
+extern struct task_struct *wrrsim_current;
+#define current                 wrrsim_current
+
+#endif /* _WRRSIM_LINUX_SCHED_H */
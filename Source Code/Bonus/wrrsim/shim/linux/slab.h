@@ -0,0 +1,26 @@
+#ifndef _WRRSIM_LINUX_SLAB_H
+#define _WRRSIM_LINUX_SLAB_H
+
+#include <linux/kernel.h>
+
+typedef unsigned int gfp_t;
+
+#define GFP_KERNEL              0
+#define GFP_NOWAIT              0
+
+static inline void *kzalloc(size_t size, gfp_t flags)
+{
+    return calloc(1, size);
+}
+
+static inline void *kzalloc_node(size_t size, gfp_t flags, int node)
+{
+    return calloc(1, size);
+}
+
+static inline void kfree(const void *p)
+{
+    free((void *)p);
+}
+
+#endif /* _WRRSIM_LINUX_SLAB_H */
@@ -0,0 +1,32 @@
+// Sysctl tables are recorded when registered so that wrrsim -s can set
+// them by procname, with the bounds of proc_dointvec_minmax().
+
+#ifndef _WRRSIM_LINUX_SYSCTL_H
+#define _WRRSIM_LINUX_SYSCTL_H
+
+#include <linux/kernel.h>
+
+#define __user
+
+struct ctl_table;
+struct ctl_table_header;
+
+typedef int proc_handler(struct ctl_table *ctl, int write,
+                         void __user *buffer, size_t *lenp, loff_t *ppos);
+
+struct ctl_table {
+    const char *procname;
+    void *data;
+    int maxlen;
+    unsigned short mode;
+    struct ctl_table *child;
+    proc_handler *proc_handler;
+    void *extra1;
+    void *extra2;
+};
+
+extern proc_handler proc_dointvec_minmax;
+
+extern struct ctl_table_header *register_sysctl_table(struct ctl_table *table);
+
+#endif /* _WRRSIM_LINUX_SYSCTL_H */
@@ -0,0 +1,35 @@
+// Every trace_sched_wrr_*() call of a class ends up in the simulator,
+// which counts it and writes it to the event log in the ftrace format.
+
+#ifndef _WRRSIM_LINUX_TRACEPOINT_H
+#define _WRRSIM_LINUX_TRACEPOINT_H
+
+#include <linux/kernel.h>
+
+struct task_struct;
+
+extern void wrrsim_trace_sched_wrr_task_template(const char *event, struct task_struct *p,
+                                                 int prio, int wrr_class);
+extern void wrrsim_trace_sched_wrr_prio_change(const char *event, struct task_struct *p,
+                                               int oldprio, int newprio);
+extern void wrrsim_trace_sched_wrr_check_preempt(const char *event, struct task_struct *curr,
+                                                 struct task_struct *p, int preempt);
+
+#define TP_PROTO(args...)       args
+#define TP_ARGS(args...)        args
+
+#define DECLARE_EVENT_CLASS(name, proto, args, ...)
+
+#define DEFINE_EVENT(template, name, proto, args)               \
+    static inline void trace_##name(proto)                      \
+    {                                                           \
+        wrrsim_trace_##template(#name, args);                   \
+    }
+
+#define TRACE_EVENT(name, proto, args, ...)                     \
+    static inline void trace_##name(proto)                      \
+    {                                                           \
+        wrrsim_trace_##name(#name, args);                       \
+    }
+
+#endif /* _WRRSIM_LINUX_TRACEPOINT_H */
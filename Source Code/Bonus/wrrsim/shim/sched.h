@@ -0,0 +1,344 @@
+// Userspace stand-in for kernel/sched.h, found by the class files' own
+// #include "sched.h" once the Makefile has copied them out of the kernel
+// tree. It models one uniprocessor runqueue. The WRR data structures and
+// the inline helpers below are copies of the kernel's and have to be kept
+// in step with it; everything else is only as deep as the classes need.
+
+#ifndef _WRRSIM_SCHED_H
+#define _WRRSIM_SCHED_H
+
+#include <linux/sched.h>
+
+#define RUNTIME_INF             ((u64)~0ULL)
+
+static inline int wrr_policy(int policy)
+{
+    return policy == SCHED_WRR;
+}
+
+#define WRR_PRIO_CHUNK_SIZE     10
+#define WRR_PRIO_CHUNKS         DIV_ROUND_UP(MAX_WRR_PRIO, WRR_PRIO_CHUNK_SIZE)
+
+struct wrr_prio_chunk {
+    struct list_head queue[WRR_PRIO_CHUNK_SIZE];
+};
+
+struct wrr_prio_array {
+    DECLARE_BITMAP(bitmap, MAX_WRR_PRIO + 1); /* include 1 bit for delimiter */
+    struct wrr_prio_chunk *chunk[WRR_PRIO_CHUNKS];
+};
+
+static inline struct list_head *wrr_prio_queue(struct wrr_prio_array *array, int prio)
+{
+    return &array->chunk[prio / WRR_PRIO_CHUNK_SIZE]->queue[prio % WRR_PRIO_CHUNK_SIZE];
+}
+
+enum wrr_group_class {
+    WRR_GROUP_OTHER = 0,
+    WRR_GROUP_FORE,
+    WRR_GROUP_BACK,
+};
+
+extern unsigned int sched_wrr_timeslice(int wrr_class, unsigned int weight);
+
+// Bandwidth is never enforced in the simulator, see sched_wrr_charge_runtime()
+struct wrr_bandwidth {
+    u64 wrr_period;
+    u64 wrr_runtime;
+};
+
+#define WRR_DEFAULT_PERIOD_US   1000000
+
+struct task_group {
+    struct sched_wrr_entity **wrr_se;
+    struct wrr_rq **wrr_rq;
+    struct wrr_bandwidth wrr_bandwidth;
+    int wrr_class;
+    unsigned int wrr_weight;
+    unsigned int wrr_timeslice;
+
+    struct task_group *parent;
+    const char *name;
+};
+
+extern struct task_group root_task_group;
+
+extern void free_wrr_sched_group(struct task_group *tg);
+extern int alloc_wrr_sched_group(struct task_group *tg, struct task_group *parent);
+extern void init_tg_wrr_entry(struct task_group *tg, struct wrr_rq *wrr_rq,
+                              struct sched_wrr_entity *wrr_se, int cpu,
+                              struct sched_wrr_entity *parent);
+extern int alloc_wrr_prio_chunks(struct task_group *tg, int prio);
+extern void free_wrr_prio_chunks(struct wrr_prio_array *array);
+
+struct wrr_rq {
+    unsigned long wrr_nr_running;
+    unsigned long wrr_weight;
+    struct {
+        int curr;
+    } highest_prio;
+    int wrr_throttled;
+    struct wrr_prio_array active;
+    struct rq *rq;
+    struct list_head leaf_wrr_rq_list;
+    struct task_group *tg;
+    u64 wrr_time;
+    u64 wrr_runtime;
+    raw_spinlock_t wrr_runtime_lock;
+#ifdef CONFIG_SCHEDSTATS
+    u64 wrr_wait_sum;
+    unsigned int wrr_wait_count;
+    unsigned int wrr_nr_slice_expired;
+    unsigned int wrr_nr_voluntary;
+    unsigned int wrr_nr_involuntary;
+    unsigned int wrr_nr_prio_changes;
+    unsigned int wrr_nr_migrations;
+#endif
+};
+
+// rt.c's runqueue for one cpu, without rt bandwidth
+struct rt_prio_array {
+    DECLARE_BITMAP(bitmap, MAX_RT_PRIO + 1);
+    struct list_head queue[MAX_RT_PRIO];
+};
+
+struct rt_rq {
+    struct rt_prio_array active;
+    unsigned long rt_nr_running;
+};
+
+struct rq {
+    raw_spinlock_t lock;
+    unsigned long nr_running;
+    u64 nr_switches;
+
+    struct rt_rq rt;
+    struct wrr_rq wrr;
+    struct list_head leaf_wrr_rq_list;
+
+    struct task_struct *curr, *idle;
+    u64 clock;
+    u64 clock_task;
+};
+
+extern struct rq wrrsim_rq;
+
+#define cpu_rq(cpu)             (&wrrsim_rq)
+#define this_rq()               (&wrrsim_rq)
+#define task_rq(p)              (&wrrsim_rq)
+
+// With one cpu, the cpu-independent clock is the rq clock
+static inline u64 local_clock(void)
+{
+    return wrrsim_rq.clock;
+}
+
+static inline int cpu_of(struct rq *rq)
+{
+    return 0;
+}
+
+static inline int task_current(struct rq *rq, struct task_struct *p)
+{
+    return rq->curr == p;
+}
+
+static inline int task_running(struct rq *rq, struct task_struct *p)
+{
+    return task_current(rq, p);
+}
+
+struct sched_class {
+    const struct sched_class *next;
+
+    void (*enqueue_task)(struct rq *rq, struct task_struct *p, int flags);
+    void (*dequeue_task)(struct rq *rq, struct task_struct *p, int flags);
+    void (*yield_task)(struct rq *rq);
+
+    void (*check_preempt_curr)(struct rq *rq, struct task_struct *p, int flags);
+
+    struct task_struct *(*pick_next_task)(struct rq *rq);
+    void (*put_prev_task)(struct rq *rq, struct task_struct *p);
+
+    void (*set_curr_task)(struct rq *rq);
+    void (*task_tick)(struct rq *rq, struct task_struct *p, int queued);
+    void (*task_fork)(struct task_struct *p);
+
+    void (*switched_from)(struct rq *this_rq, struct task_struct *task);
+    void (*switched_to)(struct rq *this_rq, struct task_struct *task);
+    void (*prio_changed)(struct rq *this_rq, struct task_struct *task, int oldprio);
+
+    unsigned int (*get_rr_interval)(struct rq *rq, struct task_struct *task);
+};
+
+#define sched_class_highest     (&rt_sched_class)
+#define for_each_class(class) \
+    for (class = sched_class_highest; class; class = class->next)
+
+extern const struct sched_class rt_sched_class;
+extern const struct sched_class fair_sched_class;
+extern const struct sched_class idle_sched_class;
+extern const struct sched_class wrr_sched_class;
+
+extern void init_rt_rq(struct rt_rq *rt_rq);
+extern void init_sched_wrr_class(void);
+
+extern void resched_task(struct task_struct *p);
+extern void check_preempt_curr(struct rq *rq, struct task_struct *p, int flags);
+extern void inc_nr_running(struct rq *rq);
+extern void dec_nr_running(struct rq *rq);
+
+extern int sched_wrr_charge_runtime(struct wrr_rq *wrr_rq, u64 delta_exec);
+extern void enable_wrr_runtime(struct rq *rq);
+extern void disable_wrr_runtime(struct rq *rq);
+extern void sched_wrr_rq_dequeue(struct wrr_rq *wrr_rq);
+extern void sched_wrr_rq_enqueue(struct wrr_rq *wrr_rq);
+
+static inline int wrr_rq_throttled(struct wrr_rq *wrr_rq)
+{
+    return wrr_rq->wrr_throttled;
+}
+
+static inline void account_group_exec_runtime(struct task_struct *tsk, u64 ns) { }
+static inline void cpuacct_charge(struct task_struct *tsk, u64 cputime) { }
+
+#ifdef CONFIG_SCHEDSTATS
+#define schedstat_inc(rq, field)        do { (rq)->field++; } while (0)
+#define schedstat_set(var, val)         do { var = (val); } while (0)
+#else
+#define schedstat_inc(rq, field)        do { } while (0)
+#define schedstat_set(var, val)         do { } while (0)
+#endif
+
+static inline struct task_group *task_group(struct task_struct *p)
+{
+    return p->sched_task_group;
+}
+
+static inline int task_wrr_class(struct task_struct *p)
+{
+    return task_group(p)->wrr_class;
+}
+
+static inline unsigned int task_wrr_timeslice(struct task_struct *p)
+{
+    return task_group(p)->wrr_timeslice;
+}
+
+static inline unsigned int task_wrr_weight(struct task_struct *p)
+{
+    return task_group(p)->wrr_weight;
+}
+
+// Groups of the classes without group runqueues have no tg->wrr_rq
+static inline void set_task_rq(struct task_struct *p, unsigned int cpu)
+{
+    struct task_group *tg = task_group(p);
+
+    if (!tg->wrr_rq)
+        return;
+
+    p->wrr.wrr_rq = tg->wrr_rq[cpu];
+    p->wrr.parent = tg->wrr_se[cpu];
+}
+
+static inline int wrr_level_before(int a, int b)
+{
+    return a < b;
+}
+
+static inline int wrr_prio_level(unsigned int rt_priority)
+{
+    return MAX_WRR_PRIO - 1 - rt_priority;
+}
+
+static inline int wrr_wakeup_preempt(struct task_struct *curr, int curr_level,
+                                     struct task_struct *p, int p_level)
+{
+    if (task_wrr_class(curr) == WRR_GROUP_BACK &&
+        task_wrr_class(p) != WRR_GROUP_BACK)
+        return 1;
+
+    if (!wrr_level_before(p_level, curr_level) &&
+        !(p_level == curr_level && p->wrr.boosted && !curr->wrr.boosted))
+        return 0;
+
+    return jiffies_to_usecs(curr->wrr.time_slice) >
+           sysctl_sched_wrr_wakeup_granularity_us;
+}
+
+static inline void wrr_task_fork(struct task_struct *p)
+{
+    struct task_struct *parent = current;
+    struct rq *rq = this_rq();
+    unsigned long flags;
+
+    raw_spin_lock_irqsave(&rq->lock, flags);
+
+    if (parent->sched_class != &wrr_sched_class)
+    {
+        p->wrr.time_slice = p->sched_class->get_rr_interval(rq, p);
+        goto out;
+    }
+
+    p->wrr.time_slice = (parent->wrr.time_slice + 1) >> 1;
+    parent->wrr.time_slice >>= 1;
+    if (!parent->wrr.time_slice)
+    {
+        parent->sched_class->yield_task(rq);
+        parent->wrr.time_slice = parent->sched_class->get_rr_interval(rq, parent);
+        parent->wrr.boosted = 0;
+        set_tsk_need_resched(parent);
+    }
+out:
+    raw_spin_unlock_irqrestore(&rq->lock, flags);
+}
+
+#ifdef CONFIG_SCHEDSTATS
+
+static inline void wrr_stats_wait_start(struct rq *rq, struct task_struct *p)
+{
+    p->wrr.statistics.wait_start = rq->clock;
+}
+
+static inline void wrr_stats_wait_end(struct rq *rq, struct task_struct *p)
+{
+    struct sched_wrr_statistics *stats = &p->wrr.statistics;
+    u64 delta;
+
+    if (!stats->wait_start)
+        return;
+
+    delta = rq->clock - stats->wait_start;
+    stats->wait_max = max(stats->wait_max, delta);
+    stats->wait_count++;
+    stats->wait_sum += delta;
+    stats->wait_start = 0;
+
+    rq->wrr.wrr_wait_count++;
+    rq->wrr.wrr_wait_sum += delta;
+}
+
+static inline void wrr_stats_switch_out(struct rq *rq, struct task_struct *p)
+{
+    if (p->on_rq)
+    {
+        p->wrr.statistics.nr_involuntary_switches++;
+        rq->wrr.wrr_nr_involuntary++;
+    }
+    else
+    {
+        p->wrr.statistics.nr_voluntary_switches++;
+        rq->wrr.wrr_nr_voluntary++;
+    }
+}
+
+#else /* CONFIG_SCHEDSTATS */
+
+static inline void wrr_stats_wait_start(struct rq *rq, struct task_struct *p) { }
+static inline void wrr_stats_wait_end(struct rq *rq, struct task_struct *p) { }
+static inline void wrr_stats_switch_out(struct rq *rq, struct task_struct *p) { }
+
+#endif /* CONFIG_SCHEDSTATS */
+
+#endif /* _WRRSIM_SCHED_H */
@@ -0,0 +1,2 @@
+// The tracepoints are plain inline functions in the simulator, see
+// linux/tracepoint.h, so there is nothing to define a second time.
@@ -0,0 +1,976 @@
+// The core.c side of the simulator: one cpu, its runqueue, the task groups
+// and the scheduler entry points, driven by an event loop on a virtual
+// clock. The WRR class under test is linked in unmodified.
+
+#ifndef WRRSIM_POLICY
+#define WRRSIM_POLICY "wrr"
+#endif
+
+#include <stdarg.h>
+#include <time.h>
+
+#include <linux/random.h>
+#include <linux/sysctl.h>
+
+#include "wrrsim.h"
+
+// SCHED_WRR, or SCHED_RR or SCHED_FIFO to run the tasks in the rt class
+int wrrsim_policy = SCHED_WRR;
+unsigned int wrrsim_hz = 100;
+unsigned long jiffies;
+struct task_struct *wrrsim_current;
+struct rq wrrsim_rq;
+struct task_group root_task_group;
+struct task_group *wrrsim_groups[3];
+
+u64 wrrsim_seed = 1;
+FILE *wrrsim_log;
+
+unsigned int sysctl_sched_wrr_fore_timeslice_us = WRR_FORE_TIMESLICE_US;
+unsigned int sysctl_sched_wrr_back_timeslice_us = WRR_BACK_TIMESLICE_US;
+unsigned int sysctl_sched_wrr_wakeup_granularity_us = WRR_WAKEUP_GRANULARITY_US;
+
+static u64 now = WRRSIM_BOOT_NS;
+static struct task_struct idle_task;
+
+const char *wrrsim_policy_name(void)
+{
+    switch (wrrsim_policy)
+    {
+        case SCHED_RR:
+            return "rr";
+        case SCHED_FIFO:
+            return "fifo";
+        default:
+            return WRRSIM_POLICY;
+    }
+}
+
+// The class the tasks run in
+static const struct sched_class *policy_class(void)
+{
+    return wrr_policy(wrrsim_policy) ? &wrr_sched_class : &rt_sched_class;
+}
+
+void wrrsim_bug(const char *file, int line, const char *cond)
+{
+    fprintf(stderr, "wrrsim: BUG at %s:%d: %s\n", file, line, cond);
+    abort();
+}
+
+void wrrsim_warn(const char *file, int line, const char *cond)
+{
+    fprintf(stderr, "wrrsim: WARNING at %s:%d: %s\n", file, line, cond);
+}
+
+// late_initcall()s, registered by constructors before main() runs
+#define WRRSIM_MAX_INITCALLS    16
+
+static initcall_t initcalls[WRRSIM_MAX_INITCALLS];
+static int nr_initcalls;
+
+void wrrsim_add_initcall(initcall_t fn)
+{
+    BUG_ON(nr_initcalls == WRRSIM_MAX_INITCALLS);
+    initcalls[nr_initcalls++] = fn;
+}
+
+// splitmix64, seeded with wrrsim -S
+u64 wrrsim_random(void)
+{
+    u64 z = (wrrsim_seed += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+void get_random_bytes(void *buf, int nbytes)
+{
+    u8 *p = buf;
+    u64 r = 0;
+    int i;
+
+    for (i = 0; i < nbytes; i++)
+    {
+        if (!(i % 8))
+            r = wrrsim_random();
+        p[i] = r >> (8 * (i % 8));
+    }
+}
+
+/*
+ * Sysctls
+ */
+
+#define WRRSIM_MAX_SYSCTL_TABLES 8
+
+struct ctl_table_header {
+    struct ctl_table *table;
+};
+
+static struct ctl_table_header sysctl_tables[WRRSIM_MAX_SYSCTL_TABLES];
+static int nr_sysctl_tables;
+
+struct ctl_table_header *register_sysctl_table(struct ctl_table *table)
+{
+    if (nr_sysctl_tables == WRRSIM_MAX_SYSCTL_TABLES)
+        return NULL;
+
+    sysctl_tables[nr_sysctl_tables].table = table;
+    return &sysctl_tables[nr_sysctl_tables++];
+}
+
+// Never called; wrrsim_set_sysctl() applies the bounds itself
+int proc_dointvec_minmax(struct ctl_table *table, int write,
+                         void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+    return -EPERM;
+}
+
+static struct ctl_table *find_sysctl(struct ctl_table *table, const char *name)
+{
+    struct ctl_table *found;
+
+    for (; table->procname; table++)
+    {
+        if (table->child)
+        {
+            found = find_sysctl(table->child, name);
+            if (found)
+                return found;
+        }
+        else if (!strcmp(table->procname, name))
+            return table;
+    }
+
+    return NULL;
+}
+
+static void list_sysctl(FILE *out, struct ctl_table *table)
+{
+    int i;
+
+    for (; table->procname; table++)
+    {
+        if (table->child)
+        {
+            list_sysctl(out, table->child);
+            continue;
+        }
+
+        fprintf(out, "%s =", table->procname);
+        for (i = 0; i < table->maxlen / (int)sizeof(int); i++)
+            fprintf(out, "%s%d", i ? "," : " ", ((int *)table->data)[i]);
+        fputc('\n', out);
+    }
+}
+
+void wrrsim_list_sysctls(FILE *out)
+{
+    int i;
+
+    for (i = 0; i < nr_sysctl_tables; i++)
+        list_sysctl(out, sysctl_tables[i].table);
+}
+
+static void tg_update_wrr_timeslice(struct task_group *tg)
+{
+    tg->wrr_timeslice = sched_wrr_timeslice(tg->wrr_class, tg->wrr_weight);
+}
+
+static void update_group_timeslices(void)
+{
+    int i;
+
+    for (i = 0; i < 3; i++)
+        tg_update_wrr_timeslice(wrrsim_groups[i]);
+}
+
+/*
+ * Set the sysctl @name to @value, a comma separated list for array
+ * sysctls, within the table's extra1/extra2 bounds as
+ * proc_dointvec_minmax() would. Returns 0 or a negative errno.
+ */
+int wrrsim_set_sysctl(const char *name, const char *value)
+{
+    struct ctl_table *table = NULL;
+    const char *s = value;
+    char *end = NULL;
+    long v;
+    int i, n;
+
+    for (i = 0; i < nr_sysctl_tables && !table; i++)
+        table = find_sysctl(sysctl_tables[i].table, name);
+    if (!table)
+        return -ENOENT;
+
+    n = table->maxlen / sizeof(int);
+    for (i = 0; i < n; i++)
+    {
+        v = strtol(s, &end, 0);
+        if (end == s)
+            return -EINVAL;
+        if ((table->extra1 && v < *(int *)table->extra1) ||
+            (table->extra2 && v > *(int *)table->extra2))
+            return -EINVAL;
+
+        ((int *)table->data)[i] = v;
+
+        if (*end != ',')
+            break;
+        s = end + 1;
+    }
+    if (*end)
+        return -EINVAL;
+
+    update_group_timeslices();
+    return 0;
+}
+
+static int min_sched_wrr_timeslice_us = 1000;
+static int max_sched_wrr_timeslice_us = 10000000;
+static int zero;
+
+static struct ctl_table sched_wrr_sysctls[] = {
+    {
+        .procname     = "sched_wrr_fore_timeslice_us",
+        .data         = &sysctl_sched_wrr_fore_timeslice_us,
+        .maxlen       = sizeof(unsigned int),
+        .mode         = 0644,
+        .proc_handler = proc_dointvec_minmax,
+        .extra1       = &min_sched_wrr_timeslice_us,
+        .extra2       = &max_sched_wrr_timeslice_us,
+    },
+    {
+        .procname     = "sched_wrr_back_timeslice_us",
+        .data         = &sysctl_sched_wrr_back_timeslice_us,
+        .maxlen       = sizeof(unsigned int),
+        .mode         = 0644,
+        .proc_handler = proc_dointvec_minmax,
+        .extra1       = &min_sched_wrr_timeslice_us,
+        .extra2       = &max_sched_wrr_timeslice_us,
+    },
+    {
+        .procname     = "sched_wrr_wakeup_granularity_us",
+        .data         = &sysctl_sched_wrr_wakeup_granularity_us,
+        .maxlen       = sizeof(unsigned int),
+        .mode         = 0644,
+        .proc_handler = proc_dointvec_minmax,
+        .extra1       = &zero,
+        .extra2       = &max_sched_wrr_timeslice_us,
+    },
+    {}
+};
+
+static struct ctl_table sched_wrr_sysctl_root[] = {
+    {
+        .procname = "kernel",
+        .mode     = 0555,
+        .child    = sched_wrr_sysctls,
+    },
+    {}
+};
+
+/*
+ * What kernel/sched/core.c provides to the WRR classes
+ */
+
+unsigned int sched_wrr_timeslice(int wrr_class, unsigned int weight)
+{
+    u64 slice_us;
+
+    if (wrr_class == WRR_GROUP_BACK)
+        slice_us = sysctl_sched_wrr_back_timeslice_us;
+    else
+        slice_us = sysctl_sched_wrr_fore_timeslice_us;
+
+    slice_us = div_u64(slice_us * weight, WRR_DEFAULT_WEIGHT);
+
+    return max_t(unsigned long, usecs_to_jiffies(slice_us), 1);
+}
+
+static struct wrr_prio_chunk root_wrr_prio_chunks[WRR_PRIO_CHUNKS];
+
+static void init_wrr_prio_chunk(struct wrr_prio_chunk *chunk)
+{
+    int i;
+
+    for (i = 0; i < WRR_PRIO_CHUNK_SIZE; i++)
+        INIT_LIST_HEAD(chunk->queue + i);
+}
+
+void init_wrr_rq(struct wrr_rq *wrr_rq, struct rq *rq)
+{
+    struct wrr_prio_array *array = &wrr_rq->active;
+    int i;
+
+    bitmap_zero(array->bitmap, MAX_WRR_PRIO);
+    __set_bit(MAX_WRR_PRIO, array->bitmap);
+
+    for (i = 0; i < WRR_PRIO_CHUNKS; i++)
+        array->chunk[i] = NULL;
+
+    wrr_rq->rq = rq;
+    wrr_rq->highest_prio.curr = MAX_WRR_PRIO;
+    wrr_rq->wrr_time = 0;
+    wrr_rq->wrr_throttled = 0;
+    wrr_rq->wrr_runtime = 0;
+    raw_spin_lock_init(&wrr_rq->wrr_runtime_lock);
+}
+
+void init_tg_wrr_entry(struct task_group *tg, struct wrr_rq *wrr_rq,
+                       struct sched_wrr_entity *wrr_se, int cpu,
+                       struct sched_wrr_entity *parent)
+{
+    struct rq *rq = cpu_rq(cpu);
+
+    wrr_rq->highest_prio.curr = MAX_WRR_PRIO;
+    wrr_rq->rq = rq;
+    wrr_rq->tg = tg;
+    wrr_rq->wrr_runtime = tg->wrr_bandwidth.wrr_runtime;
+
+    tg->wrr_rq[cpu] = wrr_rq;
+    tg->wrr_se[cpu] = wrr_se;
+
+    if (!wrr_se)
+        return;
+
+    if (!parent)
+        wrr_se->wrr_rq = &rq->wrr;
+    else
+        wrr_se->wrr_rq = parent->my_q;
+
+    wrr_se->my_q = wrr_rq;
+    wrr_se->parent = parent;
+    INIT_LIST_HEAD(&wrr_se->run_list);
+}
+
+int alloc_wrr_prio_chunks(struct task_group *tg, int prio)
+{
+    struct wrr_prio_chunk *chunk;
+    int c = prio / WRR_PRIO_CHUNK_SIZE;
+    int i;
+
+    for (; tg; tg = tg->parent)
+    {
+        if (!tg->wrr_rq)
+            continue;
+
+        for_each_possible_cpu(i)
+        {
+            if (!tg->wrr_rq[i] || tg->wrr_rq[i]->active.chunk[c])
+                continue;
+
+            chunk = calloc(1, sizeof(*chunk));
+            if (!chunk)
+                return -ENOMEM;
+            init_wrr_prio_chunk(chunk);
+            tg->wrr_rq[i]->active.chunk[c] = chunk;
+        }
+    }
+
+    return 0;
+}
+
+void free_wrr_prio_chunks(struct wrr_prio_array *array)
+{
+    int i;
+
+    for (i = 0; i < WRR_PRIO_CHUNKS; i++)
+    {
+        free(array->chunk[i]);
+        array->chunk[i] = NULL;
+    }
+}
+
+// Bandwidth is not simulated: every wrr_rq runs with RUNTIME_INF
+int sched_wrr_charge_runtime(struct wrr_rq *wrr_rq, u64 delta_exec)
+{
+    return 0;
+}
+
+void enable_wrr_runtime(struct rq *rq)
+{
+}
+
+void disable_wrr_runtime(struct rq *rq)
+{
+}
+
+void resched_task(struct task_struct *p)
+{
+    set_tsk_need_resched(p);
+}
+
+void check_preempt_curr(struct rq *rq, struct task_struct *p, int flags)
+{
+    const struct sched_class *class;
+
+    if (p->sched_class == rq->curr->sched_class)
+    {
+        rq->curr->sched_class->check_preempt_curr(rq, p, flags);
+        return;
+    }
+
+    for_each_class(class)
+    {
+        if (class == rq->curr->sched_class)
+            break;
+        if (class == p->sched_class)
+        {
+            resched_task(rq->curr);
+            break;
+        }
+    }
+}
+
+void inc_nr_running(struct rq *rq)
+{
+    rq->nr_running++;
+}
+
+void dec_nr_running(struct rq *rq)
+{
+    rq->nr_running--;
+}
+
+/*
+ * The classes below SCHED_WRR: no fair tasks are simulated, and the idle
+ * class runs the idle task whenever nothing else is runnable.
+ */
+
+static struct task_struct *pick_next_task_fair(struct rq *rq)
+{
+    return NULL;
+}
+
+const struct sched_class fair_sched_class = {
+    .next = &idle_sched_class,
+    .pick_next_task = pick_next_task_fair,
+};
+
+static void check_preempt_curr_idle(struct rq *rq, struct task_struct *p, int flags)
+{
+    resched_task(rq->idle);
+}
+
+static struct task_struct *pick_next_task_idle(struct rq *rq)
+{
+    return rq->idle;
+}
+
+static void put_prev_task_idle(struct rq *rq, struct task_struct *prev)
+{
+}
+
+static void task_tick_idle(struct rq *rq, struct task_struct *curr, int queued)
+{
+}
+
+const struct sched_class idle_sched_class = {
+    .check_preempt_curr = check_preempt_curr_idle,
+    .pick_next_task = pick_next_task_idle,
+    .put_prev_task = put_prev_task_idle,
+    .task_tick = task_tick_idle,
+};
+
+/*
+ * Event log, in the format of the ftrace text output
+ */
+
+static const char *log_comm(struct task_struct *p)
+{
+    return p->pid ? p->comm : "<idle>";
+}
+
+static void log_event(const char *event, const char *fmt, ...)
+{
+    va_list ap;
+
+    wrrsim_trace_count(event);
+
+    if (!wrrsim_log)
+        return;
+
+    fprintf(wrrsim_log, "%16s-%-5d [000] %5llu.%06llu: %s: ",
+            log_comm(current), current->pid,
+            (unsigned long long)(now / NSEC_PER_SEC),
+            (unsigned long long)(now % NSEC_PER_SEC / NSEC_PER_USEC), event);
+
+    va_start(ap, fmt);
+    vfprintf(wrrsim_log, fmt, ap);
+    va_end(ap);
+
+    fputc('\n', wrrsim_log);
+}
+
+static const char *wrr_class_name(int wrr_class)
+{
+    return wrrsim_group_name(wrr_class);
+}
+
+void wrrsim_trace_sched_wrr_task_template(const char *event, struct task_struct *p,
+                                          int prio, int wrr_class)
+{
+    log_event(event, "comm=%s pid=%d prio=%d slice=%u class=%s",
+              p->comm, p->pid, prio, p->wrr.time_slice, wrr_class_name(wrr_class));
+}
+
+void wrrsim_trace_sched_wrr_prio_change(const char *event, struct task_struct *p,
+                                        int oldprio, int newprio)
+{
+    log_event(event, "comm=%s pid=%d oldprio=%d newprio=%d",
+              p->comm, p->pid, oldprio, newprio);
+}
+
+void wrrsim_trace_sched_wrr_check_preempt(const char *event, struct task_struct *curr,
+                                          struct task_struct *p, int preempt)
+{
+    log_event(event, "curr_pid=%d pid=%d preempt=%d", curr->pid, p->pid, preempt);
+}
+
+/*
+ * Setup
+ */
+
+static void init_wrr_bandwidth(struct wrr_bandwidth *wrr_b, u64 period, u64 runtime)
+{
+    wrr_b->wrr_period = period;
+    wrr_b->wrr_runtime = runtime;
+}
+
+static struct task_group *create_group(int wrr_class)
+{
+    struct task_group *tg = calloc(1, sizeof(*tg));
+
+    if (!tg)
+        return NULL;
+
+    tg->parent = &root_task_group;
+    tg->wrr_class = wrr_class;
+    tg->wrr_weight = WRR_DEFAULT_WEIGHT;
+    init_wrr_bandwidth(&tg->wrr_bandwidth,
+                       (u64)WRR_DEFAULT_PERIOD_US * NSEC_PER_USEC, RUNTIME_INF);
+    tg_update_wrr_timeslice(tg);
+
+    if (!alloc_wrr_sched_group(tg, &root_task_group))
+    {
+        free_wrr_sched_group(tg);
+        free(tg);
+        return NULL;
+    }
+
+    return tg;
+}
+
+static void update_rq_clock(struct rq *rq)
+{
+    rq->clock = now;
+    rq->clock_task = now;
+}
+
+/*
+ * sched_init() for one cpu, the fore and back groups and the class, then
+ * the late initcalls, which register the sysctls.
+ */
+void wrrsim_init(void)
+{
+    struct rq *rq = &wrrsim_rq;
+    int i;
+
+    root_task_group.wrr_rq = calloc(nr_cpu_ids, sizeof(struct wrr_rq *));
+    root_task_group.wrr_se = calloc(nr_cpu_ids, sizeof(struct sched_wrr_entity *));
+    BUG_ON(!root_task_group.wrr_rq || !root_task_group.wrr_se);
+    init_wrr_bandwidth(&root_task_group.wrr_bandwidth,
+                       (u64)WRR_DEFAULT_PERIOD_US * NSEC_PER_USEC, RUNTIME_INF);
+    root_task_group.wrr_weight = WRR_DEFAULT_WEIGHT;
+    root_task_group.wrr_class = WRR_GROUP_OTHER;
+    tg_update_wrr_timeslice(&root_task_group);
+
+    raw_spin_lock_init(&rq->lock);
+    update_rq_clock(rq);
+    INIT_LIST_HEAD(&rq->leaf_wrr_rq_list);
+    init_rt_rq(&rq->rt);
+    init_wrr_rq(&rq->wrr, rq);
+    for (i = 0; i < WRR_PRIO_CHUNKS; i++)
+    {
+        rq->wrr.active.chunk[i] = &root_wrr_prio_chunks[i];
+        init_wrr_prio_chunk(rq->wrr.active.chunk[i]);
+    }
+    rq->wrr.wrr_runtime = RUNTIME_INF;
+    init_tg_wrr_entry(&root_task_group, &rq->wrr, NULL, 0, NULL);
+
+    strcpy(idle_task.comm, "swapper");
+    idle_task.sched_class = &idle_sched_class;
+    idle_task.sched_task_group = &root_task_group;
+    idle_task.prio = 120;
+    INIT_LIST_HEAD(&idle_task.wrr.run_list);
+    rq->idle = &idle_task;
+    rq->curr = &idle_task;
+    current = &idle_task;
+
+    wrrsim_groups[WRR_GROUP_OTHER] = &root_task_group;
+    wrrsim_groups[WRR_GROUP_FORE] = create_group(WRR_GROUP_FORE);
+    wrrsim_groups[WRR_GROUP_BACK] = create_group(WRR_GROUP_BACK);
+    BUG_ON(!wrrsim_groups[WRR_GROUP_FORE] || !wrrsim_groups[WRR_GROUP_BACK]);
+
+    init_sched_wrr_class();
+
+    register_sysctl_table(sched_wrr_sysctl_root);
+    for (i = 0; i < nr_initcalls; i++)
+        initcalls[i]();
+}
+
+void wrrsim_set_weight(int group, unsigned int weight)
+{
+    wrrsim_groups[group]->wrr_weight = weight;
+    tg_update_wrr_timeslice(wrrsim_groups[group]);
+}
+
+/*
+ * Make @t a task of wrrsim_policy in its group, as __sched_fork() followed
+ * by sched_setscheduler() would. It is woken at its start time.
+ */
+void wrrsim_add_task(struct wrrsim_task *t, int pid)
+{
+    struct task_struct *p = &t->task;
+    struct task_group *tg = wrrsim_groups[t->group];
+
+    p->pid = pid;
+    p->on_rq = 0;
+    p->prio = 120;
+    p->policy = SCHED_NORMAL;
+    p->sched_class = &fair_sched_class;
+    p->rt.nr_cpus_allowed = 1;
+    p->sched_task_group = tg;
+    INIT_LIST_HEAD(&p->rt.run_list);
+    INIT_LIST_HEAD(&p->wrr.run_list);
+    set_task_rq(p, 0);
+
+    t->state = WRRSIM_NEW;
+    t->wake_ns = WRRSIM_BOOT_NS + t->start_ns;
+
+    if (!wrr_policy(wrrsim_policy))
+    {
+        p->policy = wrrsim_policy;
+        p->prio = MAX_RT_PRIO - 1 - p->rt_priority;
+        p->sched_class = &rt_sched_class;
+        p->rt.time_slice = p->sched_class->get_rr_interval(&wrrsim_rq, p);
+        return;
+    }
+
+    if (alloc_wrr_prio_chunks(tg, wrr_prio_level(p->rt_priority)))
+        wrrsim_bug(__FILE__, __LINE__, "out of memory");
+
+    p->policy = SCHED_WRR;
+    p->sched_class = &wrr_sched_class;
+    p->wrr.prio = MAX_WRR_PRIO;
+    p->wrr.time_slice = p->sched_class->get_rr_interval(&wrrsim_rq, p);
+    p->times = 1;
+    p->wrr.fb_exec_start = p->se.sum_exec_runtime;
+    p->wrr.fb_sleep = 0;
+}
+
+/*
+ * The event loop
+ */
+
+static inline struct wrrsim_task *wrrsim_task_of(struct task_struct *p)
+{
+    return container_of(p, struct wrrsim_task, task);
+}
+
+static void enter_phase(struct wrrsim_task *t)
+{
+    const struct wrrsim_phase *ph = &t->phases[t->phase];
+    u64 len = wrrsim_phase_length(ph);
+
+    if (ph->type == WRRSIM_RUN)
+        t->left_ns = len;
+    else
+        t->wake_ns = now + len;
+}
+
+// Move @t on to its next phase; returns its type, or -1 once @t is done
+static int next_phase(struct wrrsim_task *t)
+{
+    if (++t->phase == t->nr_phases)
+    {
+        t->phase = 0;
+        if (t->repeat && ++t->round == t->repeat)
+            return -1;
+    }
+
+    enter_phase(t);
+    return t->phases[t->phase].type;
+}
+
+static void activate_task(struct rq *rq, struct task_struct *p, int flags)
+{
+    p->sched_class->enqueue_task(rq, p, flags);
+    p->on_rq = 1;
+}
+
+static void deactivate_task(struct rq *rq, struct task_struct *p, int flags)
+{
+    p->sched_class->dequeue_task(rq, p, flags);
+    p->on_rq = 0;
+}
+
+// wake_up_new_task() at the start time, try_to_wake_up() after a sleep
+static void wake_task(struct rq *rq, struct wrrsim_task *t)
+{
+    struct task_struct *p = &t->task;
+    int new = t->state == WRRSIM_NEW;
+
+    if (new)
+    {
+        t->phase = 0;
+        t->round = 0;
+        enter_phase(t);
+    }
+
+    t->state = WRRSIM_RUNNABLE;
+    t->nr_wakeups++;
+    t->woken_ns = now;
+    t->queued_ns = now;
+
+    activate_task(rq, p, new ? 0 : ENQUEUE_WAKEUP);
+    log_event(new ? "sched_wakeup_new" : "sched_wakeup",
+              "comm=%s pid=%d prio=%d success=1 target_cpu=000",
+              p->comm, p->pid, p->prio);
+    check_preempt_curr(rq, p, 0);
+}
+
+// The running task finished a run phase: carry on, sleep or exit
+static void run_done(struct wrrsim_task *t)
+{
+    int type = next_phase(t);
+
+    if (type == WRRSIM_RUN)
+        return;
+
+    t->state = type == WRRSIM_SLEEP ? WRRSIM_SLEEPING : WRRSIM_EXITED;
+    set_tsk_need_resched(&t->task);
+}
+
+static u64 clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+// What two back to back clock_ns() calls cost, taken off every pick sample
+static u64 clock_overhead_ns;
+
+static void calibrate_clock(void)
+{
+    u64 t0, t1, best = ~0ULL;
+    int i;
+
+    for (i = 0; i < 1000; i++)
+    {
+        t0 = clock_ns();
+        t1 = clock_ns();
+        best = min(best, t1 - t0);
+    }
+
+    clock_overhead_ns = best;
+}
+
+static struct task_struct *pick_next_task(struct rq *rq, struct wrrsim_result *res)
+{
+    const struct sched_class *class;
+    struct task_struct *p;
+    u64 t0, t1;
+
+    for_each_class(class)
+    {
+        if (class != policy_class())
+        {
+            p = class->pick_next_task(rq);
+        }
+        else
+        {
+            t0 = clock_ns();
+            p = class->pick_next_task(rq);
+            t1 = clock_ns();
+            wrrsim_sample_add(&res->pick_ns,
+                              t1 - t0 > clock_overhead_ns ? t1 - t0 - clock_overhead_ns : 0);
+        }
+
+        if (p)
+            return p;
+    }
+
+    BUG();
+    return NULL;
+}
+
+static const char *prev_state(struct task_struct *p)
+{
+    if (p == wrrsim_rq.idle || p->on_rq)
+        return "R";
+
+    return wrrsim_task_of(p)->state == WRRSIM_EXITED ? "x" : "S";
+}
+
+// What is left of @p's timeslice in jiffies, 0 if it has none
+static unsigned int slice_left(struct task_struct *p)
+{
+    switch (p->policy)
+    {
+        case SCHED_RR:
+            return p->rt.time_slice;
+        case SCHED_FIFO:
+            return 0;
+        default:
+            return p->wrr.time_slice;
+    }
+}
+
+static void switch_in(struct wrrsim_task *t)
+{
+    if (t->woken_ns)
+    {
+        wrrsim_sample_add(&t->latency, now - t->woken_ns);
+        t->woken_ns = 0;
+    }
+
+    if (t->queued_ns)
+    {
+        wrrsim_sample_add(&t->wait, now - t->queued_ns);
+        t->wait_sum_ns += now - t->queued_ns;
+        t->queued_ns = 0;
+    }
+
+    t->nr_runs++;
+    t->in_ns = now;
+    t->slice_ns = (u64)slice_left(&t->task) * (NSEC_PER_SEC / HZ);
+}
+
+// How much of the slice it got @t used, and whether it is left queued
+static void switch_out(struct wrrsim_task *t)
+{
+    if (t->slice_ns)
+    {
+        t->slice_used_ns += min(now - t->in_ns, t->slice_ns);
+        t->slice_given_ns += t->slice_ns;
+    }
+
+    if (t->state == WRRSIM_RUNNABLE)
+        t->queued_ns = now;
+}
+
+// __schedule()
+static void schedule(struct rq *rq, struct wrrsim_result *res)
+{
+    struct task_struct *prev = rq->curr, *next;
+
+    if (prev != rq->idle && wrrsim_task_of(prev)->state != WRRSIM_RUNNABLE)
+        deactivate_task(rq, prev, DEQUEUE_SLEEP);
+
+    prev->sched_class->put_prev_task(rq, prev);
+    next = pick_next_task(rq, res);
+    clear_tsk_need_resched(prev);
+
+    if (prev == next)
+        return;
+
+    rq->nr_switches++;
+    log_event("sched_switch",
+              "prev_comm=%s prev_pid=%d prev_prio=%d prev_state=%s ==> "
+              "next_comm=%s next_pid=%d next_prio=%d",
+              prev->comm, prev->pid, prev->prio, prev_state(prev),
+              next->comm, next->pid, next->prio);
+    rq->curr = next;
+    current = next;
+
+    if (prev != rq->idle)
+        switch_out(wrrsim_task_of(prev));
+    if (next != rq->idle)
+        switch_in(wrrsim_task_of(next));
+}
+
+static void scheduler_tick(struct rq *rq, struct wrrsim_result *res)
+{
+    jiffies++;
+    res->nr_ticks++;
+    rq->curr->sched_class->task_tick(rq, rq->curr, 0);
+}
+
+/*
+ * Run @w for its duration. Each round of the loop advances the clock to
+ * the next event - a tick, the end of the running task's run phase or a
+ * wakeup - charges the time passed to the running task, and calls into
+ * the class as the kernel would at that event.
+ */
+void wrrsim_run(struct wrrsim_workload *w, struct wrrsim_result *res)
+{
+    struct rq *rq = &wrrsim_rq;
+    u64 tick_ns = NSEC_PER_SEC / HZ;
+    u64 end = now + w->duration_ns;
+    u64 next_tick = now + tick_ns;
+    struct wrrsim_task *t, *curr;
+    u64 next, delta;
+    int i;
+
+    memset(res, 0, sizeof(*res));
+    calibrate_clock();
+
+    while (now < end)
+    {
+        curr = rq->curr == rq->idle ? NULL : wrrsim_task_of(rq->curr);
+
+        next = min(next_tick, end);
+        if (curr)
+            next = min(next, now + curr->left_ns);
+        for (i = 0; i < w->nr_tasks; i++)
+        {
+            t = w->tasks[i];
+            if (t->state == WRRSIM_NEW || t->state == WRRSIM_SLEEPING)
+                next = min(next, t->wake_ns);
+        }
+
+        delta = next - now;
+        if (curr)
+        {
+            curr->left_ns -= delta;
+            curr->runtime_ns += delta;
+        }
+        else
+            res->idle_ns += delta;
+
+        now = next;
+        update_rq_clock(rq);
+
+        if (curr && !curr->left_ns && curr->state == WRRSIM_RUNNABLE)
+            run_done(curr);
+
+        for (i = 0; i < w->nr_tasks; i++)
+        {
+            t = w->tasks[i];
+            if ((t->state == WRRSIM_NEW || t->state == WRRSIM_SLEEPING) &&
+                t->wake_ns <= now)
+                wake_task(rq, t);
+        }
+
+        if (now == next_tick)
+        {
+            scheduler_tick(rq, res);
+            next_tick += tick_ns;
+        }
+
+        if (test_tsk_need_resched(rq->curr))
+            schedule(rq, res);
+    }
+
+    if (rq->curr != rq->idle)
+        switch_out(wrrsim_task_of(rq->curr));
+
+    res->duration_ns = w->duration_ns;
+    res->nr_switches = rq->nr_switches;
+}
@@ -0,0 +1,324 @@
+// Task traces: what each simulated task does and when.
+//
+// One directive per line, '#' starts a comment:
+//
+//   duration <time>
+//   weight <fore|back|other> <cpu.wrr_weight>
+//   sysctl <name> <value>
+//   task <name>[*<n>] <fore|back|other> <rt_priority> <start> <phase>... [repeat <n>|forever]
+//   replay <recorded trace> <fore|back|other> <rt_priority> [<comm pattern>...]
+//
+// A phase is run=<time> or sleep=<time>, or a range such as run=2ms-8ms
+// which is drawn anew every time the phase comes round. The first phase
+// has to be a run. Times take an ns, us, ms or s suffix, except for 0. name*4 makes
+// four tasks name0 to name3 from one line.
+//
+// replay adds the tasks of a recorded sched_switch trace, see replay.c,
+// whose comm matches one of the shell patterns, or all of them. Tasks
+// that were not rt in the recording get <rt_priority>. A task is only
+// added by the first replay line that matches it, so
+//
+//   replay trace.txt back 50 *sync* *backup*
+//   replay trace.txt fore 50
+//
+// puts two kinds of task in the background group and the rest in the
+// foreground. A relative path is taken from the directory of the file
+// naming it.
+
+#include <libgen.h>
+
+#include "wrrsim.h"
+
+// of the workload being read, to find the recorded traces it names
+static char workload_dir[PATH_MAX] = ".";
+
+static const char *group_names[] = {
+    [WRR_GROUP_OTHER] = "other",
+    [WRR_GROUP_FORE] = "fore",
+    [WRR_GROUP_BACK] = "back",
+};
+
+const char *wrrsim_group_name(int group)
+{
+    return group_names[group];
+}
+
+int wrrsim_group_of(const char *name)
+{
+    int i;
+
+    for (i = 0; i < 3; i++)
+    {
+        if (!strcmp(name, group_names[i]))
+            return i;
+    }
+
+    return -1;
+}
+
+int wrrsim_parse_duration(const char *s, u64 *ns)
+{
+    static const struct {
+        const char *suffix;
+        double ns;
+    } units[] = {
+        { "ns", 1 },
+        { "us", 1e3 },
+        { "ms", 1e6 },
+        { "s", 1e9 },
+    };
+    char *end;
+    double v;
+    size_t i;
+
+    v = strtod(s, &end);
+    if (end == s || v < 0)
+        return -1;
+
+    // a bare 0 needs no unit
+    if (!*end && !v)
+    {
+        *ns = 0;
+        return 0;
+    }
+
+    for (i = 0; i < sizeof(units) / sizeof(units[0]); i++)
+    {
+        if (!strcmp(end, units[i].suffix))
+        {
+            *ns = (u64)(v * units[i].ns + 0.5);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+u64 wrrsim_phase_length(const struct wrrsim_phase *ph)
+{
+    if (ph->max_ns == ph->min_ns)
+        return ph->min_ns;
+
+    return ph->min_ns + wrrsim_random() % (ph->max_ns - ph->min_ns + 1);
+}
+
+struct wrrsim_task *wrrsim_new_task(struct wrrsim_workload *w, const char *name)
+{
+    struct wrrsim_task *t;
+
+    if (w->nr_tasks == w->alloc_tasks)
+    {
+        int alloc = w->alloc_tasks ? 2 * w->alloc_tasks : 16;
+        struct wrrsim_task **tasks = realloc(w->tasks, alloc * sizeof(*tasks));
+
+        if (!tasks)
+            return NULL;
+        w->tasks = tasks;
+        w->alloc_tasks = alloc;
+    }
+
+    t = calloc(1, sizeof(*t));
+    if (!t)
+        return NULL;
+
+    snprintf(t->task.comm, TASK_COMM_LEN, "%s", name);
+    t->repeat = 1;
+    w->tasks[w->nr_tasks++] = t;
+
+    return t;
+}
+
+static int parse_phase(const char *s, struct wrrsim_phase *ph)
+{
+    char buf[64];
+    char *dash;
+
+    if (!strncmp(s, "run=", 4))
+        ph->type = WRRSIM_RUN;
+    else if (!strncmp(s, "sleep=", 6))
+        ph->type = WRRSIM_SLEEP;
+    else
+        return -1;
+
+    snprintf(buf, sizeof(buf), "%s", strchr(s, '=') + 1);
+    dash = strchr(buf, '-');
+    if (dash)
+        *dash = '\0';
+
+    if (wrrsim_parse_duration(buf, &ph->min_ns))
+        return -1;
+    ph->max_ns = ph->min_ns;
+    if (dash && wrrsim_parse_duration(dash + 1, &ph->max_ns))
+        return -1;
+
+    return ph->min_ns && ph->max_ns >= ph->min_ns ? 0 : -1;
+}
+
+#define MAX_ARGS 64
+
+static int parse_task(struct wrrsim_workload *w, char **argv, int argc)
+{
+    struct wrrsim_phase phases[MAX_ARGS];
+    int nr_phases = 0, repeat = 1, group, prio, count = 1, i;
+    char name[TASK_COMM_LEN], *star;
+    struct wrrsim_task *t;
+    u64 start;
+
+    if (argc < 6)
+        return -1;
+
+    snprintf(name, sizeof(name), "%s", argv[1]);
+    star = strchr(name, '*');
+    if (star)
+    {
+        *star = '\0';
+        count = atoi(star + 1);
+        if (count < 1)
+            return -1;
+    }
+
+    group = wrrsim_group_of(argv[2]);
+    prio = atoi(argv[3]);
+    if (group < 0 || prio < 1 || prio >= MAX_WRR_PRIO)
+        return -1;
+    if (wrrsim_parse_duration(argv[4], &start))
+        return -1;
+
+    for (i = 5; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "forever"))
+            repeat = 0;
+        else if (!strcmp(argv[i], "repeat") && i + 1 < argc)
+        {
+            repeat = atoi(argv[++i]);
+            if (repeat < 1)
+                return -1;
+        }
+        else if (parse_phase(argv[i], &phases[nr_phases++]))
+            return -1;
+    }
+
+    if (!nr_phases || phases[0].type != WRRSIM_RUN)
+        return -1;
+
+    for (i = 0; i < count; i++)
+    {
+        char comm[TASK_COMM_LEN + 12];
+
+        if (count > 1)
+            snprintf(comm, sizeof(comm), "%s%d", name, i);
+        else
+            snprintf(comm, sizeof(comm), "%s", name);
+
+        t = wrrsim_new_task(w, comm);
+        if (!t)
+            return -1;
+
+        t->group = group;
+        t->task.rt_priority = prio;
+        t->start_ns = start;
+        t->repeat = repeat;
+        t->nr_phases = nr_phases;
+        t->phases = malloc(nr_phases * sizeof(*phases));
+        if (!t->phases)
+            return -1;
+        memcpy(t->phases, phases, nr_phases * sizeof(*phases));
+    }
+
+    return 0;
+}
+
+static int parse_replay(struct wrrsim_workload *w, char **argv, int argc)
+{
+    char path[PATH_MAX * 2];
+    int group, prio;
+
+    if (argc < 4)
+        return -1;
+
+    group = wrrsim_group_of(argv[2]);
+    prio = atoi(argv[3]);
+    if (group < 0 || prio < 1 || prio >= MAX_WRR_PRIO)
+        return -1;
+
+    if (argv[1][0] == '/')
+        snprintf(path, sizeof(path), "%s", argv[1]);
+    else
+        snprintf(path, sizeof(path), "%s/%s", workload_dir, argv[1]);
+
+    return wrrsim_load_recording(path, w, group, prio, argv + 4, argc - 4);
+}
+
+static int parse_line(struct wrrsim_workload *w, char *line)
+{
+    char *argv[MAX_ARGS];
+    int argc = 0, group, weight;
+    char *hash = strchr(line, '#');
+
+    if (hash)
+        *hash = '\0';
+
+    for (argv[argc] = strtok(line, " \t\r\n"); argv[argc] && argc < MAX_ARGS - 1;
+         argv[++argc] = strtok(NULL, " \t\r\n"))
+        ;
+
+    if (!argc)
+        return 0;
+
+    if (!strcmp(argv[0], "task"))
+        return parse_task(w, argv, argc);
+
+    if (!strcmp(argv[0], "replay"))
+        return parse_replay(w, argv, argc);
+
+    if (!strcmp(argv[0], "duration") && argc == 2)
+        return wrrsim_parse_duration(argv[1], &w->duration_ns);
+
+    if (!strcmp(argv[0], "weight") && argc == 3)
+    {
+        group = wrrsim_group_of(argv[1]);
+        weight = atoi(argv[2]);
+        if (group < 0 || weight < WRR_MIN_WEIGHT || weight > WRR_MAX_WEIGHT)
+            return -1;
+        w->weight[group] = weight;
+        return 0;
+    }
+
+    if (!strcmp(argv[0], "sysctl") && argc == 3)
+        return wrrsim_set_sysctl(argv[1], argv[2]) ? -1 : 0;
+
+    return -1;
+}
+
+int wrrsim_load_workload(const char *path, struct wrrsim_workload *w)
+{
+    char line[1024], dir[PATH_MAX];
+    int lineno = 0;
+    FILE *f;
+
+    snprintf(dir, sizeof(dir), "%s", path);
+    snprintf(workload_dir, sizeof(workload_dir), "%s", dirname(dir));
+
+    f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+    if (!f)
+    {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f))
+    {
+        lineno++;
+        if (parse_line(w, line))
+        {
+            fprintf(stderr, "%s:%d: cannot parse this line\n", path, lineno);
+            if (f != stdin)
+                fclose(f);
+            return -1;
+        }
+    }
+
+    if (f != stdin)
+        fclose(f);
+    return 0;
+}
@@ -0,0 +1,125 @@
+// wrrsim: runs the WRR scheduling classes in userspace on a virtual clock.
+//
+// sim.c plays the part of kernel/sched/core.c for one cpu, rt.c that of
+// the rt class, workload.c reads the task traces, replay.c turns recorded
+// traces into tasks and report.c summarises a run.
+
+#ifndef _WRRSIM_H
+#define _WRRSIM_H
+
+#include "sched.h"
+
+// Virtual time starts at one second of uptime, so that no timestamp the
+// classes take is 0, which they use to mean "not set".
+#define WRRSIM_BOOT_NS          NSEC_PER_SEC
+
+enum wrrsim_phase_type {
+    WRRSIM_RUN,
+    WRRSIM_SLEEP,
+};
+
+// A phase lasts a uniformly drawn time in [min_ns, max_ns]
+struct wrrsim_phase {
+    int type;
+    u64 min_ns;
+    u64 max_ns;
+};
+
+struct wrrsim_samples {
+    u64 *ns;
+    size_t nr;
+    size_t alloc;
+};
+
+enum wrrsim_task_state {
+    WRRSIM_NEW,
+    WRRSIM_RUNNABLE,
+    WRRSIM_SLEEPING,
+    WRRSIM_EXITED,
+};
+
+struct wrrsim_task {
+    // what the classes see; pid 0 is the idle task
+    struct task_struct task;
+
+    // the workload
+    int group;                  // enum wrr_group_class
+    u64 start_ns;               // since the start of the run
+    struct wrrsim_phase *phases;
+    int nr_phases;
+    int repeat;                 // rounds through the phases, 0 for no end
+
+    // where the task is in its workload
+    int state;
+    int phase;
+    int round;
+    u64 left_ns;                // of the current run phase
+    u64 wake_ns;                // of the current sleep, or the start
+    u64 woken_ns;               // last wakeup not yet followed by a run
+    u64 queued_ns;              // runnable and off the cpu since, or 0
+    u64 in_ns;                  // on the cpu since
+    u64 slice_ns;               // of its slice left when it got the cpu
+
+    // what it got
+    u64 runtime_ns;
+    u64 nr_wakeups;
+    u64 nr_runs;                // times it got the cpu
+    u64 wait_sum_ns;
+    u64 slice_used_ns;          // of the slices it was given, capped at them
+    u64 slice_given_ns;
+    struct wrrsim_samples latency;  // from a wakeup to running
+    struct wrrsim_samples wait;     // from becoming runnable or preempted to running
+};
+
+struct wrrsim_workload {
+    struct wrrsim_task **tasks;
+    int nr_tasks;
+    int alloc_tasks;
+    u64 duration_ns;
+    u64 replay_ns;              // the longest recorded trace replayed
+    unsigned int weight[3];     // cpu.wrr_weight by enum wrr_group_class
+};
+
+struct wrrsim_result {
+    u64 duration_ns;
+    u64 idle_ns;
+    u64 nr_switches;
+    u64 nr_ticks;
+    struct wrrsim_samples pick_ns;
+};
+
+// sim.c
+extern int wrrsim_policy;
+extern u64 wrrsim_seed;
+extern FILE *wrrsim_log;
+extern struct task_group *wrrsim_groups[3];
+
+extern void wrrsim_init(void);
+extern int wrrsim_set_sysctl(const char *name, const char *value);
+extern void wrrsim_list_sysctls(FILE *out);
+extern void wrrsim_set_weight(int group, unsigned int weight);
+extern void wrrsim_add_task(struct wrrsim_task *t, int pid);
+extern void wrrsim_run(struct wrrsim_workload *w, struct wrrsim_result *res);
+extern u64 wrrsim_random(void);
+extern const char *wrrsim_policy_name(void);
+
+// workload.c
+extern int wrrsim_parse_duration(const char *s, u64 *ns);
+extern int wrrsim_load_workload(const char *path, struct wrrsim_workload *w);
+extern struct wrrsim_task *wrrsim_new_task(struct wrrsim_workload *w, const char *name);
+extern u64 wrrsim_phase_length(const struct wrrsim_phase *ph);
+extern const char *wrrsim_group_name(int group);
+extern int wrrsim_group_of(const char *name);
+
+// replay.c
+extern int wrrsim_is_recording(const char *path);
+extern int wrrsim_load_recording(const char *path, struct wrrsim_workload *w, int group,
+                                 int rt_priority, char **patterns, int nr_patterns);
+
+// report.c
+extern void wrrsim_sample_add(struct wrrsim_samples *s, u64 ns);
+extern void wrrsim_trace_count(const char *event);
+extern void wrrsim_report(FILE *out, struct wrrsim_workload *w, struct wrrsim_result *res,
+                          int summary);
+
+#endif /* _WRRSIM_H */